@@ -0,0 +1,56 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+#include "shared-from-this/weak.h"
+
+// Copy/destroy throughput of SharedPtr with atomic reference counting.
+// The NonAtomicCounting row is the single-threaded baseline the atomic rows are compared to;
+// "same block" makes every thread hammer one control block, "own block" shows the price of the
+// atomic instructions alone.
+
+constexpr size_t kIterations = 5'000'000;
+
+int main() {
+    auto local = MakeShared<int, NonAtomicCounting>(42);
+    Report("SharedPtr copy/destroy, NonAtomicCounting", 1,
+           MeasureNsPerOp(1, kIterations, [&](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   SharedPtr<int, NonAtomicCounting> copy(local);
+                   DoNotOptimize(copy);
+               }
+           }));
+
+    for (size_t threads : ThreadCounts()) {
+        auto shared = MakeShared<int>(42);
+        Report("SharedPtr copy/destroy, same block", threads,
+               MeasureNsPerOp(threads, kIterations, [&](size_t, size_t iterations) {
+                   for (size_t i = 0; i < iterations; ++i) {
+                       SharedPtr<int> copy(shared);
+                       DoNotOptimize(copy);
+                   }
+               }));
+    }
+
+    for (size_t threads : ThreadCounts()) {
+        Report("SharedPtr copy/destroy, own block", threads,
+               MeasureNsPerOp(threads, kIterations, [&](size_t, size_t iterations) {
+                   auto own = MakeShared<int>(42);
+                   for (size_t i = 0; i < iterations; ++i) {
+                       SharedPtr<int> copy(own);
+                       DoNotOptimize(copy);
+                   }
+               }));
+    }
+
+    for (size_t threads : ThreadCounts()) {
+        auto shared = MakeShared<int>(42);
+        Report("WeakPtr copy/destroy, same block", threads,
+               MeasureNsPerOp(threads, kIterations, [&](size_t, size_t iterations) {
+                   WeakPtr<int> weak(shared);
+                   for (size_t i = 0; i < iterations; ++i) {
+                       WeakPtr<int> copy(weak);
+                       DoNotOptimize(copy);
+                   }
+               }));
+    }
+}
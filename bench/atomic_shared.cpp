@@ -0,0 +1,57 @@
+#include "bench.h"
+
+#include "shared-from-this/atomic_shared.h"
+
+#include <mutex>
+
+// Readers loading a published SharedPtr while one writer keeps replacing it: AtomicSharedPtr
+// against a mutex-guarded SharedPtr.
+
+constexpr size_t kIterations = 2'000'000;
+
+struct Config {
+    int version;
+};
+
+struct MutexSharedPtr {
+    SharedPtr<Config> Load() {
+        std::lock_guard lock(mutex);
+        return value;
+    }
+    void Store(SharedPtr<Config> desired) {
+        std::lock_guard lock(mutex);
+        value = desired;
+    }
+
+    std::mutex mutex;
+    SharedPtr<Config> value = MakeShared<Config>(0);
+};
+
+template <typename Published>
+void ReadersAndWriter(const char* name, size_t readers) {
+    Published published;
+    published.Store(MakeShared<Config>(0));
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        for (int version = 1; !stop.load(std::memory_order_relaxed); ++version) {
+            published.Store(MakeShared<Config>(version));
+            std::this_thread::yield();
+        }
+    });
+    double ns = MeasureNsPerOp(readers, kIterations, [&](size_t, size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            auto config = published.Load();
+            DoNotOptimize(config->version);
+        }
+    });
+    stop = true;
+    writer.join();
+    Report(name, readers, ns);
+}
+
+int main() {
+    for (size_t readers : ThreadCounts()) {
+        ReadersAndWriter<AtomicSharedPtr<Config>>("Load with 1 writer, AtomicSharedPtr", readers);
+        ReadersAndWriter<MutexSharedPtr>("Load with 1 writer, mutex", readers);
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Keeps the optimizer from throwing away the measured value.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Thread counts 1, 2, 4, ... up to the number of hardware threads.
+inline std::vector<size_t> ThreadCounts() {
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    std::vector<size_t> counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+// Runs `body(thread_index, iterations)` on `threads` threads released at the same moment.
+// Returns wall-clock nanoseconds per iteration of a single thread.
+template <typename F>
+double MeasureNsPerOp(size_t threads, size_t iterations, F&& body) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            body(i, iterations);
+        });
+    }
+    while (ready.load() != threads) {
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+inline void Report(const char* name, size_t threads, double ns_per_op) {
+    std::printf("%-48s threads=%-3zu %9.2f ns/op %9.2f Mops/s\n", name, threads, ns_per_op,
+                threads * 1e3 / ns_per_op);
+}
+
+// Bumped by the global operator new of benchmarks that replace it, to report allocations per op.
+inline size_t allocation_count = 0;
+
+// Single-thread cost of one operation: mean, median and 99th percentile over batches.
+struct Distribution {
+    double mean_ns = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double allocations = 0;
+};
+
+// Times `samples` batches of `batch` calls to `body(index)`, with an untimed `setup()` before
+// each batch. Each batch gives one sample of nanoseconds per call.
+template <typename Setup, typename Body>
+Distribution SampleNsPerOp(size_t samples, size_t batch, Setup&& setup, Body&& body) {
+    std::vector<double> ns_per_op;
+    ns_per_op.reserve(samples);
+    size_t allocations = 0;
+    for (size_t sample = 0; sample < samples; ++sample) {
+        setup();
+        size_t allocations_before = allocation_count;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            body(i);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        allocations += allocation_count - allocations_before;
+        ns_per_op.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / batch);
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    Distribution result;
+    for (double ns : ns_per_op) {
+        result.mean_ns += ns / samples;
+    }
+    result.p50_ns = ns_per_op[samples / 2];
+    result.p99_ns = ns_per_op[samples * 99 / 100];
+    result.allocations = double(allocations) / (samples * batch);
+    return result;
+}
+
+inline void Report(const char* name, const char* operation, const Distribution& distribution) {
+    std::printf("%-28s %-12s %9.2f ns/op  p50 %9.2f  p99 %9.2f  %5.2f allocs/op\n", name,
+                operation, distribution.mean_ns, distribution.p50_ns, distribution.p99_ns,
+                distribution.allocations);
+}
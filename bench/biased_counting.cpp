@@ -0,0 +1,41 @@
+#include "bench.h"
+
+#include "shared-from-this/biased.h"
+
+// Copy/destroy cost on the thread that created the block, where BiasedCounting should stay close
+// to NonAtomicCounting, and on other threads, where it pays for the atomic path.
+
+constexpr size_t kIterations = 20'000'000;
+
+template <typename Policy>
+void OwnerCopies(const char* name) {
+    Report(name, 1, MeasureNsPerOp(1, kIterations, [](size_t, size_t iterations) {
+               auto own = MakeShared<int, Policy>(42);
+               for (size_t i = 0; i < iterations; ++i) {
+                   SharedPtr<int, Policy> copy(own);
+                   DoNotOptimize(copy);
+               }
+           }));
+}
+
+template <typename Policy>
+void ForeignCopies(const char* name, size_t threads) {
+    auto shared = MakeShared<int, Policy>(42);
+    Report(name, threads, MeasureNsPerOp(threads, kIterations / 4, [&](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   SharedPtr<int, Policy> copy(shared);
+                   DoNotOptimize(copy);
+               }
+           }));
+}
+
+int main() {
+    OwnerCopies<NonAtomicCounting>("owner copy/destroy, NonAtomicCounting");
+    OwnerCopies<BiasedCounting>("owner copy/destroy, BiasedCounting");
+    OwnerCopies<AtomicCounting>("owner copy/destroy, AtomicCounting");
+
+    for (size_t threads : ThreadCounts()) {
+        ForeignCopies<BiasedCounting>("foreign copy/destroy, BiasedCounting", threads);
+        ForeignCopies<AtomicCounting>("foreign copy/destroy, AtomicCounting", threads);
+    }
+}
@@ -0,0 +1,38 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+
+#include <memory>
+
+// Create/destroy churn of every kind of control block, next to std::shared_ptr. This is the path
+// where the block's dispatch function is called: once at the last strong release, which also frees
+// the block when no WeakPtr is left.
+
+constexpr size_t kIterations = 5'000'000;
+
+template <typename F>
+void Churn(const char* name, F&& make) {
+    Report(name, 1, MeasureNsPerOp(1, kIterations, [&](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   DoNotOptimize(make(i));
+               }
+           }));
+}
+
+int main() {
+    std::printf("sizeof(Block<int>) = %zu, sizeof(BlockEmplace<int>) = %zu\n",
+                sizeof(Block<int, AtomicCounting>), sizeof(BlockEmplace<int, AtomicCounting>));
+
+    Churn("SharedPtr(new int)", [](size_t i) { return SharedPtr<int>(new int(i)); });
+    Churn("std::shared_ptr(new int)", [](size_t i) { return std::shared_ptr<int>(new int(i)); });
+    Churn("MakeShared<int>", [](size_t i) { return MakeShared<int>(static_cast<int>(i)); });
+    Churn("std::make_shared<int>",
+          [](size_t i) { return std::make_shared<int>(static_cast<int>(i)); });
+    Churn("SharedPtr(new int, deleter)", [](size_t i) {
+        return SharedPtr<int>(new int(i), [](int* ptr) { delete ptr; });
+    });
+    Churn("std::shared_ptr(new int, deleter)", [](size_t i) {
+        return std::shared_ptr<int>(new int(i), [](int* ptr) { delete ptr; });
+    });
+    Churn("MakeShared<int[]>(16)", [](size_t) { return MakeShared<int[]>(16); });
+}
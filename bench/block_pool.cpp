@@ -0,0 +1,53 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Churn of SharedPtrs adopting raw pointers, whose control blocks come from BlockPool, next to
+// std::shared_ptr. "Burst" frees the pointers a batch at a time, so the pool has to hold up to a
+// whole batch of blocks; "steady" frees each one right after making it.
+
+constexpr size_t kSamples = 2000;
+constexpr size_t kBatch = 128;
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+template <typename Ptr, typename Make>
+void Churn(const char* name, Make&& make) {
+    std::vector<Ptr> burst(kBatch);
+    Report(name, "burst", SampleNsPerOp(kSamples, kBatch, [&] { burst.assign(kBatch, Ptr()); },
+                                        [&](size_t i) { burst[i] = make(i); }));
+    Report(name, "steady", SampleNsPerOp(kSamples, kBatch, [] {}, [&](size_t i) {
+               DoNotOptimize(make(i));
+           }));
+}
+
+int main() {
+    auto deleter = [](int* ptr) { delete ptr; };
+    Churn<SharedPtr<int>>("SharedPtr(new)", [](size_t i) { return SharedPtr<int>(new int(i)); });
+    Churn<std::shared_ptr<int>>("std::shared_ptr(new)",
+                                [](size_t i) { return std::shared_ptr<int>(new int(i)); });
+    Churn<SharedPtr<int>>("SharedPtr(new, deleter)",
+                          [&](size_t i) { return SharedPtr<int>(new int(i), deleter); });
+    Churn<std::shared_ptr<int>>("std::shared_ptr(new, deleter)", [&](size_t i) {
+        return std::shared_ptr<int>(new int(i), deleter);
+    });
+}
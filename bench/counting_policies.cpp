@@ -0,0 +1,50 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+#include "shared-from-this/weak.h"
+
+// Copy/destroy cost of SharedPtr for every counting policy on a single thread, and of the
+// thread-safe ones when the same block is shared between threads.
+
+constexpr size_t kIterations = 20'000'000;
+
+template <typename Policy>
+void CopyDestroy(const char* name, size_t threads) {
+    auto shared = MakeShared<int, Policy>(42);
+    Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   SharedPtr<int, Policy> copy(shared);
+                   DoNotOptimize(copy);
+               }
+           }));
+}
+
+int main() {
+    CopyDestroy<NonAtomicCounting>("copy/destroy, NonAtomicCounting", 1);
+    CopyDestroy<AtomicCounting>("copy/destroy, AtomicCounting", 1);
+    CopyDestroy<NoWeakCounting>("copy/destroy, NoWeakCounting", 1);
+
+    for (size_t threads : ThreadCounts()) {
+        CopyDestroy<AtomicCounting>("copy/destroy shared, AtomicCounting", threads);
+        CopyDestroy<NoWeakCounting>("copy/destroy shared, NoWeakCounting", threads);
+    }
+
+    Report("MakeShared+release, NonAtomicCounting", 1,
+           MeasureNsPerOp(1, kIterations / 10, [](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   DoNotOptimize(MakeShared<int, NonAtomicCounting>(1));
+               }
+           }));
+    Report("MakeShared+release, AtomicCounting", 1,
+           MeasureNsPerOp(1, kIterations / 10, [](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   DoNotOptimize(MakeShared<int, AtomicCounting>(1));
+               }
+           }));
+    Report("MakeShared+release, NoWeakCounting", 1,
+           MeasureNsPerOp(1, kIterations / 10, [](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   DoNotOptimize(MakeShared<int, NoWeakCounting>(1));
+               }
+           }));
+}
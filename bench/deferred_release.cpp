@@ -0,0 +1,76 @@
+#include "bench.h"
+
+#include "shared-from-this/deferred.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Latency of dropping the last pointer to an object graph inside a "handler", with inline
+// destruction and with DeferredCounting, whose reclaimer thread destroys the graph instead.
+// Prints a log2 histogram of the release latency and its tail percentiles.
+
+constexpr size_t kSamples = 2000;
+constexpr size_t kGraphSize = 4096;
+
+template <typename Policy>
+struct Node {
+    std::vector<SharedPtr<Node, Policy>> children;
+    char payload[48] = {};
+};
+
+// A wide tree: the root holds a few nodes, each holding many leaves
+template <typename Policy>
+SharedPtr<Node<Policy>, Policy> BuildGraph() {
+    auto root = MakeShared<Node<Policy>, Policy>();
+    for (size_t i = 0; i < 16; ++i) {
+        auto inner = MakeShared<Node<Policy>, Policy>();
+        for (size_t j = 0; j < kGraphSize / 16; ++j) {
+            inner->children.push_back(MakeShared<Node<Policy>, Policy>());
+        }
+        root->children.push_back(std::move(inner));
+    }
+    return root;
+}
+
+template <typename Policy>
+void Measure(const char* name) {
+    std::vector<double> latencies;
+    latencies.reserve(kSamples);
+    for (size_t sample = 0; sample < kSamples; ++sample) {
+        auto graph = BuildGraph<Policy>();
+        auto start = std::chrono::steady_clock::now();
+        graph.Reset();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        latencies.push_back(std::chrono::duration<double, std::nano>(elapsed).count());
+    }
+    Reclaimer::Flush();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[static_cast<size_t>(p * (kSamples - 1))]; };
+    std::printf("%s: p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns\n", name,
+                percentile(0.5), percentile(0.99), percentile(0.999), latencies.back());
+
+    size_t bucket_count[40] = {};
+    for (double ns : latencies) {
+        size_t bucket = 0;
+        while (bucket + 1 < std::size(bucket_count) && ns >= (2 << bucket)) {
+            ++bucket;
+        }
+        ++bucket_count[bucket];
+    }
+    for (size_t bucket = 0; bucket < std::size(bucket_count); ++bucket) {
+        if (bucket_count[bucket] != 0) {
+            std::printf("  < %10zu ns %6zu  %s\n", size_t{2} << bucket, bucket_count[bucket],
+                        std::string(bucket_count[bucket] * 60 / kSamples, '#').c_str());
+        }
+    }
+}
+
+int main() {
+    Measure<AtomicCounting>("inline release");
+    Measure<DeferredCounting>("deferred release");
+}
@@ -0,0 +1,41 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+#include "shared-from-this/weak.h"
+
+#include <vector>
+
+// Copy throughput of SharedPtr for a type that derives from EnableSharedFromThis and for one
+// that does not: every thread copies pointers out of a shared table and drops the copies.
+
+constexpr size_t kIterations = 10'000'000;
+constexpr size_t kObjects = 1024;
+
+struct Plain {
+    size_t value;
+};
+
+struct Tracked : EnableSharedFromThis<Tracked> {
+    size_t value;
+};
+
+template <typename T>
+void Run(const char* name) {
+    std::vector<SharedPtr<T>> table;
+    for (size_t i = 0; i < kObjects; ++i) {
+        table.push_back(MakeShared<T>());
+    }
+    for (size_t threads : ThreadCounts()) {
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t thread, size_t n) {
+                   for (size_t i = 0; i < n; ++i) {
+                       SharedPtr<T> copy = table[(i * 7 + thread) % kObjects];
+                       DoNotOptimize(copy);
+                   }
+               }));
+    }
+}
+
+int main() {
+    Run<Plain>("SharedPtr copy, plain type");
+    Run<Tracked>("SharedPtr copy, EnableSharedFromThis type");
+}
@@ -0,0 +1,34 @@
+#include "bench.h"
+
+#include "shared-from-this/expiry.h"
+
+// Cost of MakeShared followed by the last release, for AtomicCounting, for ExpiryCounting with no
+// listener, and for ExpiryCounting with one listener attached before the release.
+
+constexpr size_t kIterations = 5'000'000;
+
+template <typename Policy, typename Body>
+void Run(const char* name, Body&& body) {
+    for (size_t threads : ThreadCounts()) {
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t, size_t n) {
+                   for (size_t i = 0; i < n; ++i) {
+                       body(MakeShared<size_t, Policy>(i));
+                   }
+               }));
+    }
+}
+
+size_t notified = 0;
+
+int main() {
+    Run<AtomicCounting>("AtomicCounting", [](SharedPtr<size_t>&& sp) { DoNotOptimize(sp); });
+    Run<ExpiryCounting<>>("ExpiryCounting, no listener",
+                          [](SharedPtr<size_t, ExpiryCounting<>>&& sp) { DoNotOptimize(sp); });
+    Run<ExpiryCounting<>>("ExpiryCounting, one listener",
+                          [](SharedPtr<size_t, ExpiryCounting<>>&& sp) {
+                              ExpiryListener<> listener([](ExpiryListener<>*) { ++notified; });
+                              listener.Listen(sp);
+                              sp.Reset();
+                          });
+    DoNotOptimize(notified);
+}
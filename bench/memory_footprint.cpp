@@ -0,0 +1,65 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+#include "shared-from-this/weak.h"
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+// Heap footprint of many small MakeShared objects for each counting policy, next to
+// std::make_shared. "Requested" is what operator new was asked for, "usable" what malloc
+// actually handed out, allocator rounding included.
+
+constexpr size_t kObjects = 1'000'000;
+
+static size_t requested_bytes = 0;
+static size_t usable_bytes = 0;
+
+void* operator new(size_t size) {
+    void* ptr = std::malloc(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    requested_bytes += size;
+    usable_bytes += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+template <typename Make>
+void Footprint(const char* name, Make&& make) {
+    using Ptr = decltype(make());
+    auto holder = std::make_unique<Ptr[]>(kObjects);
+    size_t requested_before = requested_bytes;
+    size_t usable_before = usable_bytes;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kObjects; ++i) {
+        holder[i] = make();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-40s requested %5.1f B/object, usable %5.1f B/object, %6.2f ns/object\n", name,
+                double(requested_bytes - requested_before) / kObjects,
+                double(usable_bytes - usable_before) / kObjects,
+                std::chrono::duration<double, std::nano>(elapsed).count() / kObjects);
+}
+
+int main() {
+    Footprint("MakeShared<int, NonAtomicCounting>",
+              [] { return MakeShared<int, NonAtomicCounting>(1); });
+    Footprint("MakeShared<int, PackedCounting>", [] { return MakeShared<int, PackedCounting>(1); });
+    Footprint("MakeShared<int, AtomicCounting>", [] { return MakeShared<int, AtomicCounting>(1); });
+    Footprint("MakeShared<int, PackedAtomicCounting>",
+              [] { return MakeShared<int, PackedAtomicCounting>(1); });
+    Footprint("MakeShared<int, NoWeakCounting>", [] { return MakeShared<int, NoWeakCounting>(1); });
+    Footprint("std::make_shared<int>", [] { return std::make_shared<int>(1); });
+}
@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+
+#include <cstdio>
+#include <utility>
+
+// Aliasing constructor and pointer casts, copying from an lvalue next to moving out of an rvalue.
+// The policy counts the reference count operations, to show that the moved paths do none.
+
+constexpr size_t kIterations = 20'000'000;
+
+struct OpCounting : AtomicCounting {
+    void IncStrong() {
+        ++operations;
+        AtomicCounting::IncStrong();
+    }
+    bool DecStrong() {
+        ++operations;
+        return AtomicCounting::DecStrong();
+    }
+
+    inline static size_t operations = 0;
+};
+
+struct Base {
+    virtual ~Base() = default;
+    int value = 0;
+};
+
+struct Derived : Base {
+    int field = 0;
+};
+
+using BasePtr = SharedPtr<Base, OpCounting>;
+using DerivedPtr = SharedPtr<Derived, OpCounting>;
+using FieldPtr = SharedPtr<int, OpCounting>;
+
+// `step(ptr)` turns the pointer into one of the same type, through whatever it measures
+template <typename Step>
+void Run(const char* name, Step&& step) {
+    DerivedPtr ptr = MakeShared<Derived, OpCounting>();
+    OpCounting::operations = 0;
+    double ns = MeasureNsPerOp(1, kIterations, [&](size_t, size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            ptr = step(ptr);
+            DoNotOptimize(ptr.ptr_);
+        }
+    });
+    std::printf("%-48s %9.2f ns/op %6.2f refcount ops/op\n", name, ns,
+                static_cast<double>(OpCounting::operations) / kIterations);
+}
+
+int main() {
+    Run("aliasing, copy", [](DerivedPtr& ptr) {
+        FieldPtr field(ptr, &ptr->field);
+        return DerivedPtr(field, ptr.Get());
+    });
+    Run("aliasing, move", [](DerivedPtr& ptr) {
+        Derived* raw = ptr.Get();
+        FieldPtr field(std::move(ptr), &raw->field);
+        return DerivedPtr(std::move(field), raw);
+    });
+    Run("StaticPointerCast, copy", [](DerivedPtr& ptr) {
+        BasePtr base = StaticPointerCast<Base>(ptr);
+        return StaticPointerCast<Derived>(base);
+    });
+    Run("StaticPointerCast, move", [](DerivedPtr& ptr) {
+        BasePtr base = StaticPointerCast<Base>(std::move(ptr));
+        return StaticPointerCast<Derived>(std::move(base));
+    });
+    Run("DynamicPointerCast, copy", [](DerivedPtr& ptr) {
+        BasePtr base = StaticPointerCast<Base>(ptr);
+        return DynamicPointerCast<Derived>(base);
+    });
+    Run("DynamicPointerCast, move", [](DerivedPtr& ptr) {
+        BasePtr base = StaticPointerCast<Base>(std::move(ptr));
+        return DynamicPointerCast<Derived>(std::move(base));
+    });
+    Run("ConstPointerCast, copy", [](DerivedPtr& ptr) {
+        SharedPtr<const Derived, OpCounting> constant = ConstPointerCast<const Derived>(ptr);
+        return ConstPointerCast<Derived>(constant);
+    });
+    Run("ConstPointerCast, move", [](DerivedPtr& ptr) {
+        SharedPtr<const Derived, OpCounting> constant =
+            ConstPointerCast<const Derived>(std::move(ptr));
+        return ConstPointerCast<Derived>(std::move(constant));
+    });
+}
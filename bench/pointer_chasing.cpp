@@ -0,0 +1,66 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Walks a long linked list whose links are SharedPtrs to nodes allocated in random order, through
+// Get() and operator->. Only the nodes are touched: the observers read the stored pointer, so the
+// control blocks, a separate cache line each, stay out of the loop. Raw pointers are the floor.
+
+constexpr size_t kNodes = 1 << 20;
+constexpr size_t kWalks = 10;
+
+struct Node {
+    SharedPtr<Node> next;
+    Node* raw_next = nullptr;
+    int64_t value = 0;
+};
+
+int main() {
+    std::vector<size_t> allocation_order(kNodes);
+    std::iota(allocation_order.begin(), allocation_order.end(), 0);
+    std::shuffle(allocation_order.begin(), allocation_order.end(), std::mt19937_64(42));
+
+    // Kept in list order, so that they are destroyed front to back without recursion.
+    std::vector<SharedPtr<Node>> nodes(kNodes);
+    for (size_t index : allocation_order) {
+        nodes[index] = SharedPtr<Node>(new Node{{}, nullptr, int64_t(index)});
+    }
+    for (size_t i = 0; i + 1 < kNodes; ++i) {
+        nodes[i]->next = nodes[i + 1];
+        nodes[i]->raw_next = nodes[i + 1].Get();
+    }
+
+    Report("walk via Get()", 1, MeasureNsPerOp(1, kWalks * kNodes, [&](size_t, size_t) {
+               for (size_t walk = 0; walk < kWalks; ++walk) {
+                   int64_t sum = 0;
+                   for (const Node* node = nodes[0].Get(); node; node = node->next.Get()) {
+                       sum += node->value;
+                   }
+                   DoNotOptimize(sum);
+               }
+           }));
+    Report("walk via operator->", 1, MeasureNsPerOp(1, kWalks * kNodes, [&](size_t, size_t) {
+               for (size_t walk = 0; walk < kWalks; ++walk) {
+                   int64_t sum = nodes[0]->value;
+                   for (auto* link = &nodes[0]->next; *link; link = &(*link)->next) {
+                       sum += (*link)->value;
+                   }
+                   DoNotOptimize(sum);
+               }
+           }));
+    Report("walk via raw pointers", 1, MeasureNsPerOp(1, kWalks * kNodes, [&](size_t, size_t) {
+               for (size_t walk = 0; walk < kWalks; ++walk) {
+                   int64_t sum = 0;
+                   for (const Node* node = nodes[0].Get(); node; node = node->raw_next) {
+                       sum += node->value;
+                   }
+                   DoNotOptimize(sum);
+               }
+           }));
+}
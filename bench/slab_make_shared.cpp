@@ -0,0 +1,71 @@
+#include "bench.h"
+
+#include "shared-from-this/slab.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Allocation throughput of MakeShared with blocks from the per-thread slab heaps, next to plain
+// MakeShared and std::make_shared. "Local" frees every pointer on the thread that made it;
+// "handoff" swaps each batch with a shared slot, so most blocks die on another thread and go back
+// to their home slab through its remote list.
+
+constexpr size_t kIterations = 2'000'000;
+constexpr size_t kBatch = 256;
+
+struct Payload {
+    explicit Payload(size_t value) : value(value) {
+    }
+
+    size_t value;
+    size_t padding[3] = {};
+};
+
+template <typename Ptr, typename Make>
+void Local(const char* name, Make&& make) {
+    for (size_t threads : ThreadCounts()) {
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t, size_t iterations) {
+                   std::vector<Ptr> batch(kBatch);
+                   for (size_t i = 0; i < iterations; ++i) {
+                       batch[i % kBatch] = make(i);
+                   }
+               }));
+    }
+}
+
+template <typename Ptr, typename Make>
+void Handoff(const char* name, Make&& make) {
+    for (size_t threads : ThreadCounts()) {
+        std::mutex lock;
+        std::vector<Ptr> slot;
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t, size_t iterations) {
+                   std::vector<Ptr> batch;
+                   batch.reserve(kBatch);
+                   for (size_t i = 0; i < iterations; ++i) {
+                       batch.push_back(make(i));
+                       if (batch.size() == kBatch) {
+                           {
+                               std::lock_guard guard(lock);
+                               slot.swap(batch);
+                           }
+                           batch.clear();
+                       }
+                   }
+               }));
+    }
+}
+
+int main() {
+    auto slab = [](size_t i) { return MakeSharedOnSlab<Payload>(i); };
+    auto global = [](size_t i) { return MakeShared<Payload>(i); };
+    auto std_make = [](size_t i) { return std::make_shared<Payload>(i); };
+
+    Local<SharedPtr<Payload>>("MakeSharedOnSlab, local", slab);
+    Local<SharedPtr<Payload>>("MakeShared, local", global);
+    Local<std::shared_ptr<Payload>>("std::make_shared, local", std_make);
+
+    Handoff<SharedPtr<Payload>>("MakeSharedOnSlab, handoff", slab);
+    Handoff<SharedPtr<Payload>>("MakeShared, handoff", global);
+    Handoff<std::shared_ptr<Payload>>("std::make_shared, handoff", std_make);
+}
@@ -0,0 +1,204 @@
+#include "bench.h"
+
+#include "intrusive/intrusive.h"
+#include "shared-from-this/shared.h"
+#include "shared-from-this/weak.h"
+#include "unique/unique.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Our pointers next to their std counterparts, one operation at a time on a single thread:
+// construct, copy, move, dereference, reset to a new object, destroy, and WeakPtr::Lock.
+// libstdc++'s shared_ptr counts without atomics until the program starts a second thread, which
+// this one never does.
+
+constexpr size_t kSamples = 2000;
+constexpr size_t kBatch = 256;
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+struct Payload {
+    int64_t value = 1;
+};
+
+struct IntrusivePayload : SimpleRefCounted<IntrusivePayload> {
+    int64_t value = 1;
+};
+
+// What each kind of pointer is made, reset and destroyed with
+
+struct OurUnique {
+    using Ptr = UniquePtr<Payload>;
+    static Ptr Make() {
+        return Ptr(new Payload);
+    }
+    static void Reset(Ptr& ptr) {
+        ptr.Reset(new Payload);
+    }
+    static void Destroy(Ptr& ptr) {
+        ptr.Reset();
+    }
+};
+
+struct StdUnique {
+    using Ptr = std::unique_ptr<Payload>;
+    static Ptr Make() {
+        return Ptr(new Payload);
+    }
+    static void Reset(Ptr& ptr) {
+        ptr.reset(new Payload);
+    }
+    static void Destroy(Ptr& ptr) {
+        ptr.reset();
+    }
+};
+
+struct OurSharedNew {
+    using Ptr = SharedPtr<Payload>;
+    using Weak = WeakPtr<Payload>;
+    static Ptr Make() {
+        return Ptr(new Payload);
+    }
+    static Ptr Lock(const Weak& weak) {
+        return weak.Lock();
+    }
+    static void Reset(Ptr& ptr) {
+        ptr.Reset(new Payload);
+    }
+    static void Destroy(Ptr& ptr) {
+        ptr.Reset();
+    }
+};
+
+struct OurMakeShared : OurSharedNew {
+    static Ptr Make() {
+        return MakeShared<Payload>();
+    }
+    static void Reset(Ptr& ptr) {
+        ptr = MakeShared<Payload>();
+    }
+};
+
+struct StdSharedNew {
+    using Ptr = std::shared_ptr<Payload>;
+    using Weak = std::weak_ptr<Payload>;
+    static Ptr Make() {
+        return Ptr(new Payload);
+    }
+    static Ptr Lock(const Weak& weak) {
+        return weak.lock();
+    }
+    static void Reset(Ptr& ptr) {
+        ptr.reset(new Payload);
+    }
+    static void Destroy(Ptr& ptr) {
+        ptr.reset();
+    }
+};
+
+struct StdMakeShared : StdSharedNew {
+    static Ptr Make() {
+        return std::make_shared<Payload>();
+    }
+    static void Reset(Ptr& ptr) {
+        ptr = std::make_shared<Payload>();
+    }
+};
+
+struct OurIntrusive {
+    using Ptr = IntrusivePtr<IntrusivePayload>;
+    static Ptr Make() {
+        return MakeIntrusive<IntrusivePayload>();
+    }
+    static void Reset(Ptr& ptr) {
+        ptr.Reset(new IntrusivePayload);
+    }
+    static void Destroy(Ptr& ptr) {
+        ptr.Reset();
+    }
+};
+
+template <typename Kind, typename = void>
+struct HasWeak : std::false_type {};
+
+template <typename Kind>
+struct HasWeak<Kind, std::void_t<typename Kind::Weak>> : std::true_type {};
+
+template <typename Kind>
+void Run(const char* name) {
+    using Ptr = typename Kind::Ptr;
+    std::vector<Ptr> slots(kBatch);
+    std::vector<Ptr> others(kBatch);
+    auto empty = [&] {
+        for (size_t i = 0; i < kBatch; ++i) {
+            Kind::Destroy(slots[i]);
+            Kind::Destroy(others[i]);
+        }
+    };
+    auto fill = [&] {
+        for (size_t i = 0; i < kBatch; ++i) {
+            if (!slots[i]) {
+                slots[i] = Kind::Make();
+            }
+            Kind::Destroy(others[i]);
+        }
+    };
+
+    Report(name, "construct",
+           SampleNsPerOp(kSamples, kBatch, empty, [&](size_t i) { slots[i] = Kind::Make(); }));
+    if constexpr (std::is_copy_constructible_v<Ptr>) {
+        Report(name, "copy",
+               SampleNsPerOp(kSamples, kBatch, fill, [&](size_t i) { others[i] = slots[i]; }));
+    }
+    Report(name, "move", SampleNsPerOp(kSamples, kBatch, fill, [&](size_t i) {
+               others[i] = std::move(slots[i]);
+           }));
+    Report(name, "dereference", SampleNsPerOp(kSamples, kBatch, fill, [&](size_t i) {
+               DoNotOptimize(slots[i]->value);
+           }));
+    Report(name, "reset",
+           SampleNsPerOp(kSamples, kBatch, fill, [&](size_t i) { Kind::Reset(slots[i]); }));
+    Report(name, "destroy",
+           SampleNsPerOp(kSamples, kBatch, fill, [&](size_t i) { Kind::Destroy(slots[i]); }));
+    if constexpr (HasWeak<Kind>::value) {
+        std::vector<typename Kind::Weak> weak(kBatch);
+        auto fill_weak = [&] {
+            fill();
+            for (size_t i = 0; i < kBatch; ++i) {
+                weak[i] = slots[i];
+            }
+        };
+        Report(name, "weak lock", SampleNsPerOp(kSamples, kBatch, fill_weak, [&](size_t i) {
+                   DoNotOptimize(Kind::Lock(weak[i]));
+               }));
+    }
+    empty();
+}
+
+int main() {
+    Run<OurUnique>("UniquePtr");
+    Run<StdUnique>("std::unique_ptr");
+    Run<OurSharedNew>("SharedPtr(new)");
+    Run<StdSharedNew>("std::shared_ptr(new)");
+    Run<OurMakeShared>("MakeShared");
+    Run<StdMakeShared>("std::make_shared");
+    Run<OurIntrusive>("IntrusivePtr");
+}
@@ -0,0 +1,41 @@
+#include "bench.h"
+
+#include "shared-from-this/thin_weak.h"
+#include "shared-from-this/weak.h"
+
+#include <vector>
+
+// An observer table of weak references to a set of objects: the bytes it takes per reference,
+// and the cost of locking its entries, for WeakPtr and ThinWeakPtr.
+
+constexpr size_t kIterations = 10'000'000;
+constexpr size_t kObjects = 1024;
+constexpr size_t kObservers = 1'000'000;
+
+template <typename Weak>
+void Run(const char* name) {
+    std::vector<SharedPtr<size_t>> strong;
+    for (size_t i = 0; i < kObjects; ++i) {
+        strong.push_back(MakeShared<size_t>(i));
+    }
+    std::vector<Weak> table;
+    table.reserve(kObservers);
+    for (size_t i = 0; i < kObservers; ++i) {
+        table.emplace_back(strong[i % kObjects]);
+    }
+    std::printf("%-48s %zu B/reference, %6.1f MiB per %zu references\n", name, sizeof(Weak),
+                double(table.capacity() * sizeof(Weak)) / (1 << 20), kObservers);
+    for (size_t threads : ThreadCounts()) {
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t thread, size_t n) {
+                   for (size_t i = 0; i < n; ++i) {
+                       auto locked = table[(i * 7 + thread) % kObservers].Lock();
+                       DoNotOptimize(locked);
+                   }
+               }));
+    }
+}
+
+int main() {
+    Run<WeakPtr<size_t>>("WeakPtr::Lock");
+    Run<ThinWeakPtr<size_t>>("ThinWeakPtr::Lock");
+}
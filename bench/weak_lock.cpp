@@ -0,0 +1,45 @@
+#include "bench.h"
+
+#include "shared-from-this/weak.h"
+
+#include <memory>
+#include <vector>
+
+// WeakPtr::Lock under contention: every thread promotes and releases weak references to a set of
+// objects, while thread 0 also drops their last strong references one by one, so that a growing
+// share of the promotions race the release or find the object expired.
+
+constexpr size_t kIterations = 2'000'000;
+constexpr size_t kObjects = 1024;
+
+template <typename Shared, typename Weak, typename Make, typename Lock>
+void Run(const char* name, Make&& make, Lock&& lock) {
+    for (size_t threads : ThreadCounts()) {
+        std::vector<Shared> strong;
+        std::vector<Weak> weak;
+        for (size_t i = 0; i < kObjects; ++i) {
+            strong.push_back(make(i));
+            weak.emplace_back(strong.back());
+        }
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t thread, size_t n) {
+                   size_t stride = n / kObjects;
+                   for (size_t i = 0; i < n; ++i) {
+                       if (thread == 0 && i % stride == 0 && i / stride < kObjects) {
+                           strong[i / stride] = Shared();
+                       }
+                       auto locked = lock(weak[(i * 7 + thread) % kObjects]);
+                       DoNotOptimize(locked);
+                   }
+               }));
+    }
+}
+
+int main() {
+    Run<SharedPtr<size_t>, WeakPtr<size_t>>(
+        "WeakPtr::Lock, last release racing", [](size_t i) { return MakeShared<size_t>(i); },
+        [](const WeakPtr<size_t>& weak) { return weak.Lock(); });
+    Run<std::shared_ptr<size_t>, std::weak_ptr<size_t>>(
+        "std::weak_ptr::lock, last release racing",
+        [](size_t i) { return std::make_shared<size_t>(i); },
+        [](const std::weak_ptr<size_t>& weak) { return weak.lock(); });
+}
@@ -0,0 +1,82 @@
+#include "bench.h"
+
+#include "shared-from-this/shared.h"
+#include "shared-from-this/weak.h"
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Memory pinned by a cache of WeakPtrs after every strong reference is gone, with the payload
+// inside the control block (the MakeShared default) and in its own allocation
+// (kSeparatePayloadBytes).
+
+constexpr size_t kObjects = 10'000;
+
+static size_t live_bytes = 0;
+
+void* operator new(size_t size) {
+    void* ptr = std::malloc(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    live_bytes += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    live_bytes -= malloc_usable_size(ptr);
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+struct InlinePage {
+    char data[16384];
+};
+
+struct SeparatePage {
+    char data[16384];
+};
+
+template <>
+inline constexpr size_t kSeparatePayloadBytes<SeparatePage> = 4096;
+
+template <typename Page>
+size_t PinnedBytes(const char* name) {
+    std::vector<WeakPtr<Page>> cache;
+    cache.reserve(kObjects);
+    size_t before = live_bytes;
+    for (size_t i = 0; i < kObjects; ++i) {
+        auto page = MakeShared<Page>();
+        cache.push_back(page);
+    }
+    size_t pinned = live_bytes - before;
+    std::printf("%-32s %9.2f MiB pinned by %zu expired WeakPtrs\n", name, pinned / 1048576.0,
+                kObjects);
+    return pinned;
+}
+
+int main() {
+    size_t inline_bytes = PinnedBytes<InlinePage>("16 KiB payload, inline");
+    size_t separate_bytes = PinnedBytes<SeparatePage>("16 KiB payload, separate");
+    std::printf("saved %.2f MiB (%.1f%%)\n", (inline_bytes - separate_bytes) / 1048576.0,
+                100.0 * (inline_bytes - separate_bytes) / inline_bytes);
+
+    Report("MakeShared+release, inline", 1,
+           MeasureNsPerOp(1, 200'000, [](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   DoNotOptimize(MakeShared<InlinePage>());
+               }
+           }));
+    Report("MakeShared+release, separate", 1,
+           MeasureNsPerOp(1, 200'000, [](size_t, size_t iterations) {
+               for (size_t i = 0; i < iterations; ++i) {
+                   DoNotOptimize(MakeShared<SeparatePage>());
+               }
+           }));
+}
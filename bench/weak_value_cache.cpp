@@ -0,0 +1,46 @@
+#include "bench.h"
+
+#include "shared-from-this/weak_value_cache.h"
+
+#include <vector>
+
+// Lookup throughput of WeakValueCache with 16 shards against a single locked shard. All values
+// but every kUnpinned-th are kept alive from outside, so most requests hit; the others find their
+// value expired and build it again, purging as they go.
+
+constexpr size_t kIterations = 1'000'000;
+constexpr size_t kKeys = 4096;
+constexpr size_t kUnpinned = 16;
+
+struct Asset {
+    explicit Asset(size_t id) : id(id) {
+    }
+
+    size_t id;
+    char bytes[64] = {};
+};
+
+template <size_t kShards>
+void Run(const char* name) {
+    for (size_t threads : ThreadCounts()) {
+        WeakValueCache<size_t, Asset, AtomicCounting, std::hash<size_t>, kShards> cache;
+        std::vector<SharedPtr<Asset>> pinned;
+        for (size_t key = 0; key < kKeys; ++key) {
+            if (key % kUnpinned != 0) {
+                pinned.push_back(cache.GetOrCreate(key, key));
+            }
+        }
+        Report(name, threads, MeasureNsPerOp(threads, kIterations, [&](size_t thread, size_t n) {
+                   for (size_t i = 0; i < n; ++i) {
+                       size_t key = (i * 2654435761u + thread * 977) % kKeys;
+                       auto value = cache.GetOrCreate(key, key);
+                       DoNotOptimize(value.Get());
+                   }
+               }));
+    }
+}
+
+int main() {
+    Run<16>("WeakValueCache, 16 shards");
+    Run<1>("WeakValueCache, 1 shard");
+}
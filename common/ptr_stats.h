@@ -0,0 +1,197 @@
+#pragma once
+
+// Opt-in statistics for UniquePtr, SharedPtr, WeakPtr and IntrusivePtr, collected per pointee type.
+// Build with -DSMART_PTR_STATS to turn them on; without it every PTR_STATS hook expands to nothing,
+// the condition of PTR_STATS_IF included.
+//
+// Counters, per pointer kind and type:
+//   allocations  objects (control blocks for SharedPtr) that came under the pointer's ownership
+//   live, peak   of those, how many are not destroyed yet, and the most there ever were at once
+//   constructions, copies, moves, destructions  of non-empty pointers
+//   increments, decrements  of reference counts (the weak count for WeakPtr)
+// An IntrusivePtr converted to a base class pointer counts the object's release against the base.
+
+#ifdef SMART_PTR_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+class PtrStats {
+public:
+    enum Kind { kUniquePtr, kSharedPtr, kWeakPtr, kIntrusivePtr };
+    enum Event {
+        kAllocate,
+        kRelease,
+        kConstruct,
+        kCopy,
+        kMove,
+        kDestroy,
+        kIncRef,
+        kDecRef,
+    };
+    enum SortBy { kByAllocations, kByLive, kByPeak, kByRefTraffic };
+
+    // Lives in static storage and is never destroyed, so that pointers dying during static
+    // destruction can still count, and recording needs no allocation.
+    struct Counters {
+        Counters(Kind kind, std::string_view type) : kind(kind), type(type) {
+            next = all.load(std::memory_order_relaxed);
+            while (!all.compare_exchange_weak(next, this, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+            }
+        }
+
+        Kind kind;
+        std::string_view type;
+        const Counters* next;
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<int64_t> live{0};
+        std::atomic<int64_t> peak{0};
+        std::atomic<uint64_t> constructions{0};
+        std::atomic<uint64_t> copies{0};
+        std::atomic<uint64_t> moves{0};
+        std::atomic<uint64_t> destructions{0};
+        std::atomic<uint64_t> increments{0};
+        std::atomic<uint64_t> decrements{0};
+    };
+
+    template <Kind kKind, typename T>
+    static void Record(Event event) {
+        static Counters counters(kKind, TypeName<T>());
+        switch (event) {
+            case kAllocate: {
+                counters.allocations.fetch_add(1, std::memory_order_relaxed);
+                int64_t live = counters.live.fetch_add(1, std::memory_order_relaxed) + 1;
+                int64_t peak = counters.peak.load(std::memory_order_relaxed);
+                while (peak < live && !counters.peak.compare_exchange_weak(
+                                          peak, live, std::memory_order_relaxed)) {
+                }
+                break;
+            }
+            case kRelease:
+                counters.live.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            case kConstruct:
+                counters.constructions.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case kCopy:
+                counters.copies.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case kMove:
+                counters.moves.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case kDestroy:
+                counters.destructions.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case kIncRef:
+                counters.increments.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case kDecRef:
+                counters.decrements.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+    }
+
+    // Every (kind, type) pair seen so far. The counters live until the program ends.
+    static std::vector<const Counters*> Snapshot() {
+        std::vector<const Counters*> result;
+        for (auto counters = all.load(std::memory_order_acquire); counters;
+             counters = counters->next) {
+            result.push_back(counters);
+        }
+        return result;
+    }
+
+    // Prints one line per (kind, type), biggest first
+    static void Report(std::FILE* out = stderr, SortBy by = kByAllocations) {
+        auto rows = Snapshot();
+        std::stable_sort(rows.begin(), rows.end(), [by](const Counters* lhs, const Counters* rhs) {
+            return SortKey(*lhs, by) > SortKey(*rhs, by);
+        });
+        std::fprintf(out, "%-12s %-40s %10s %8s %8s %10s %10s %10s %10s %10s %10s\n", "kind",
+                     "type", "allocs", "live", "peak", "ctors", "copies", "moves", "dtors", "incs",
+                     "decs");
+        for (const Counters* counters : rows) {
+            std::fprintf(out,
+                         "%-12s %-40.*s %10llu %8lld %8lld "
+                         "%10llu %10llu %10llu %10llu %10llu %10llu\n",
+                         KindName(counters->kind), static_cast<int>(counters->type.size()),
+                         counters->type.data(),
+                         Load(counters->allocations), Load(counters->live),
+                         Load(counters->peak), Load(counters->constructions),
+                         Load(counters->copies), Load(counters->moves),
+                         Load(counters->destructions), Load(counters->increments),
+                         Load(counters->decrements));
+        }
+    }
+
+    // Prints the report to stderr when the program exits. Later calls only change the order.
+    static void ReportAtExit(SortBy by = kByAllocations) {
+        static std::atomic<bool> registered{false};
+        at_exit_order.store(by, std::memory_order_relaxed);
+        if (!registered.exchange(true)) {
+            std::atexit([] { Report(stderr, at_exit_order.load(std::memory_order_relaxed)); });
+        }
+    }
+
+private:
+    // Works for incomplete types too, unlike typeid
+    template <typename T>
+    static std::string_view TypeName() {
+        std::string_view signature = __PRETTY_FUNCTION__;
+        size_t begin = signature.find("T = ") + 4;
+        size_t end = signature.find(';', begin);
+        if (end == std::string_view::npos) {
+            end = signature.rfind(']');
+        }
+        return signature.substr(begin, end - begin);
+    }
+
+    static const char* KindName(Kind kind) {
+        static const char* const kNames[] = {"UniquePtr", "SharedPtr", "WeakPtr", "IntrusivePtr"};
+        return kNames[kind];
+    }
+
+    static long long SortKey(const Counters& counters, SortBy by) {
+        switch (by) {
+            case kByLive:
+                return Load(counters.live);
+            case kByPeak:
+                return Load(counters.peak);
+            case kByRefTraffic:
+                return Load(counters.increments) + Load(counters.decrements);
+            default:
+                return Load(counters.allocations);
+        }
+    }
+
+    static long long Load(const std::atomic<int64_t>& value) {
+        return value.load(std::memory_order_relaxed);
+    }
+    static unsigned long long Load(const std::atomic<uint64_t>& value) {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    inline static std::atomic<const Counters*> all{nullptr};
+    inline static std::atomic<SortBy> at_exit_order{kByAllocations};
+};
+
+#define PTR_STATS(kind, T, event) PtrStats::Record<PtrStats::k##kind, T>(PtrStats::k##event)
+#define PTR_STATS_IF(condition, kind, T, event) \
+    do {                                        \
+        if (condition) {                        \
+            PTR_STATS(kind, T, event);          \
+        }                                       \
+    } while (false)
+
+#else
+
+#define PTR_STATS(kind, T, event) static_cast<void>(0)
+#define PTR_STATS_IF(condition, kind, T, event) static_cast<void>(0)
+
+#endif
@@ -0,0 +1,99 @@
+#include <intrusive/intrusive.h>
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+#include <unique/unique.h>
+
+#include <catch.hpp>
+
+#include <cstdio>
+#include <string_view>
+
+#ifndef SMART_PTR_STATS
+#error "build this test with SMART_PTR_STATS"
+#endif
+
+struct Node : SimpleRefCounted<Node> {};
+struct Widget {};
+struct Gadget {};
+
+const PtrStats::Counters& Find(PtrStats::Kind kind, std::string_view type) {
+    for (const PtrStats::Counters* counters : PtrStats::Snapshot()) {
+        if (counters->kind == kind && counters->type == type) {
+            return *counters;
+        }
+    }
+    FAIL("no counters for " << type);
+    throw;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedPtr and WeakPtr") {
+    {
+        auto first = MakeShared<Widget>();
+        SharedPtr<Widget> second(new Widget);
+        auto copy = first;
+        auto moved = std::move(copy);
+        WeakPtr<Widget> weak = first;
+        auto locked = weak.Lock();
+    }
+    auto& shared = Find(PtrStats::kSharedPtr, "Widget");
+    REQUIRE(shared.allocations == 2);
+    REQUIRE(shared.live == 0);
+    REQUIRE(shared.peak == 2);
+    REQUIRE(shared.constructions == 3);
+    REQUIRE(shared.copies == 1);
+    REQUIRE(shared.moves == 1);
+    REQUIRE(shared.destructions == 4);
+    REQUIRE(shared.increments == 2);
+    REQUIRE(shared.decrements == 4);
+
+    auto& weak = Find(PtrStats::kWeakPtr, "Widget");
+    REQUIRE(weak.constructions == 1);
+    REQUIRE(weak.increments == 1);
+    REQUIRE(weak.decrements == 1);
+}
+
+TEST_CASE("IntrusivePtr") {
+    {
+        auto first = MakeIntrusive<Node>();
+        IntrusivePtr<Node> second = first;
+        IntrusivePtr<Node> third(first.Get());
+        REQUIRE(Find(PtrStats::kIntrusivePtr, "Node").live == 1);
+    }
+    auto& counters = Find(PtrStats::kIntrusivePtr, "Node");
+    REQUIRE(counters.allocations == 1);
+    REQUIRE(counters.live == 0);
+    REQUIRE(counters.constructions == 2);
+    REQUIRE(counters.copies == 1);
+    REQUIRE(counters.increments == 3);
+    REQUIRE(counters.decrements == 3);
+}
+
+TEST_CASE("UniquePtr") {
+    {
+        UniquePtr<Gadget> first(new Gadget);
+        UniquePtr<Gadget> second = std::move(first);
+        second.Reset(new Gadget);
+    }
+    auto& counters = Find(PtrStats::kUniquePtr, "Gadget");
+    REQUIRE(counters.allocations == 2);
+    REQUIRE(counters.live == 0);
+    REQUIRE(counters.peak == 1);
+    REQUIRE(counters.moves == 1);
+    REQUIRE(counters.destructions == 2);
+}
+
+TEST_CASE("Report") {
+    MakeShared<Widget>();
+    std::FILE* out = std::tmpfile();
+    PtrStats::Report(out, PtrStats::kByAllocations);
+    std::rewind(out);
+    char line[256];
+    REQUIRE(std::fgets(line, sizeof(line), out));
+    REQUIRE(std::string_view(line).find("allocs") != std::string_view::npos);
+    REQUIRE(std::fgets(line, sizeof(line), out));
+    // Three Widgets were allocated, more than anything else
+    REQUIRE(std::string_view(line).find("Widget") != std::string_view::npos);
+    std::fclose(out);
+}
@@ -4,6 +4,8 @@
 #include <utility>  // for std::exchange / std::swap
 #include <iostream>
 
+#include <common/ptr_stats.h>
+
 class SimpleCounter {
 public:
     size_t IncRef() {
@@ -76,7 +78,7 @@ public:
     }
     IntrusivePtr(T* ptr) : ptr_(ptr) {
         if (ptr_) {
-            ptr_->IncRef();
+            Adopt();
         }
     }
 
@@ -85,6 +87,8 @@ public:
         Reset();
         ptr_ = static_cast<T*>(other.ptr_);
         if (ptr_) {
+            PTR_STATS(IntrusivePtr, T, Copy);
+            PTR_STATS(IntrusivePtr, T, IncRef);
             ptr_->IncRef();
         }
     }
@@ -93,6 +97,7 @@ public:
     IntrusivePtr(IntrusivePtr<Y>&& other) {
         Reset();
         ptr_ = static_cast<T*>(other.ptr_);
+        PTR_STATS_IF(ptr_, IntrusivePtr, T, Move);
         other.ptr_ = nullptr;
     }
 
@@ -101,6 +106,8 @@ public:
             Reset();
             ptr_ = other.ptr_;
             if (ptr_) {
+                PTR_STATS(IntrusivePtr, T, Copy);
+                PTR_STATS(IntrusivePtr, T, IncRef);
                 ptr_->IncRef();
             }
         }
@@ -109,6 +116,7 @@ public:
         if (this != &other) {
             Reset();
             ptr_ = other.ptr_;
+            PTR_STATS_IF(ptr_, IntrusivePtr, T, Move);
             other.ptr_ = nullptr;
         }
     }
@@ -122,6 +130,8 @@ public:
             Reset();
             ptr_ = other.ptr_;
             if (ptr_) {
+                PTR_STATS(IntrusivePtr, T, Copy);
+                PTR_STATS(IntrusivePtr, T, IncRef);
                 ptr_->IncRef();
             }
         }
@@ -135,6 +145,7 @@ public:
             Reset();
         }
         ptr_ = other.ptr_;
+        PTR_STATS_IF(ptr_, IntrusivePtr, T, Move);
         other.ptr_ = nullptr;
         return *this;
     }
@@ -148,6 +159,9 @@ public:
     // Modifiers
     void Reset() {
         if (ptr_) {
+            PTR_STATS(IntrusivePtr, T, Destroy);
+            PTR_STATS(IntrusivePtr, T, DecRef);
+            PTR_STATS_IF(ptr_->RefCount() == 1, IntrusivePtr, T, Release);
             ptr_->DecRef();
         }
         ptr_ = nullptr;
@@ -156,7 +170,7 @@ public:
         Reset();
         ptr_ = ptr;
         if (ptr_) {
-            ptr_->IncRef();
+            Adopt();
         }
     }
     void Swap(IntrusivePtr& other) {
@@ -184,6 +198,14 @@ public:
     }
 
 private:
+    // Takes a reference to a raw pointer; the first one puts the object under our ownership
+    void Adopt() {
+        PTR_STATS(IntrusivePtr, T, Construct);
+        PTR_STATS(IntrusivePtr, T, IncRef);
+        ptr_->IncRef();
+        PTR_STATS_IF(ptr_->RefCount() == 1, IntrusivePtr, T, Allocate);
+    }
+
     T* ptr_ = nullptr;
 };
 
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Lock-free atomic SharedPtr with split reference counting.
+//
+// The current value lives in a heap node, and a single 64-bit word holds the node pointer in its
+// low 48 bits together with an "external" count of readers in the high 16 bits. A reader bumps
+// the external count with a CAS, copies the SharedPtr out of the node, and gives the count back
+// with another one. A writer swaps the word and moves the external count of the old node
+// into its "internal" count; readers that lost the race settle there instead, and whoever brings
+// the internal count to zero frees the node. An empty value has no node and takes no external
+// references, so a node address cannot come back while anyone still counts on it.
+template <typename T, typename Policy = AtomicCounting>
+class AtomicSharedPtr {
+    static_assert(!std::is_same_v<Policy, NonAtomicCounting> &&
+                      !std::is_same_v<Policy, PackedCounting>,
+                  "AtomicSharedPtr needs a thread-safe counting policy");
+    static_assert(sizeof(void*) == sizeof(uint64_t), "pointer packing needs a 64-bit platform");
+
+    struct Node {
+        explicit Node(SharedPtr<T, Policy>&& value) : value(std::move(value)) {
+        }
+        SharedPtr<T, Policy> value;
+        std::atomic<int64_t> internal{0};
+    };
+
+    static constexpr int kPtrBits = 48;
+    static constexpr uint64_t kPtrMask = (uint64_t{1} << kPtrBits) - 1;
+    static constexpr uint64_t kExternalOne = uint64_t{1} << kPtrBits;
+
+public:
+    static constexpr bool kIsAlwaysLockFree = std::atomic<uint64_t>::is_always_lock_free;
+
+    AtomicSharedPtr() = default;
+    AtomicSharedPtr(SharedPtr<T, Policy> value) : word_(Pack(MakeNode(std::move(value)))) {
+    }
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    ~AtomicSharedPtr() {
+        delete Unpack(word_.load(std::memory_order_acquire));
+    }
+
+    SharedPtr<T, Policy> Load() const {
+        Node* node = Unpack(AcquireExternal());
+        SharedPtr<T, Policy> result;
+        if (node) {
+            result = node->value;
+        }
+        ReleaseExternal(node);
+        return result;
+    }
+
+    void Store(SharedPtr<T, Policy> desired) {
+        Exchange(std::move(desired));
+    }
+
+    SharedPtr<T, Policy> Exchange(SharedPtr<T, Policy> desired) {
+        uint64_t old =
+            word_.exchange(Pack(MakeNode(std::move(desired))), std::memory_order_acq_rel);
+        Node* node = Unpack(old);
+        if (!node) {
+            return SharedPtr<T, Policy>();
+        }
+        SharedPtr<T, Policy> result = node->value;
+        RetireNode(node, Count(old));
+        return result;
+    }
+
+    // Replaces the value with `desired` if it holds the same pointer and control block as
+    // `expected`; otherwise loads the current value into `expected`.
+    bool CompareExchange(SharedPtr<T, Policy>& expected, SharedPtr<T, Policy> desired) {
+        Node* desired_node = nullptr;
+        while (true) {
+            uint64_t current = AcquireExternal();
+            Node* node = Unpack(current);
+            if (!Holds(node, expected)) {
+                expected = node ? node->value : SharedPtr<T, Policy>();
+                ReleaseExternal(node);
+                delete desired_node;
+                return false;
+            }
+            if (!desired_node) {
+                desired_node = MakeNode(std::move(desired));
+            }
+            while (Unpack(current) == node) {
+                if (word_.compare_exchange_weak(current, Pack(desired_node),
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_relaxed)) {
+                    // Our own external reference goes away with the node.
+                    if (node) {
+                        RetireNode(node, Count(current) - 1);
+                    }
+                    return true;
+                }
+            }
+            ReleaseExternal(node);
+        }
+    }
+
+private:
+    static Node* MakeNode(SharedPtr<T, Policy>&& value) {
+        if (!value.block_) {
+            return nullptr;
+        }
+        return new Node(std::move(value));
+    }
+
+    static uint64_t Pack(Node* node) {
+        return reinterpret_cast<uint64_t>(node);
+    }
+    static Node* Unpack(uint64_t word) {
+        return reinterpret_cast<Node*>(word & kPtrMask);
+    }
+    static int64_t Count(uint64_t word) {
+        return static_cast<int64_t>(word >> kPtrBits);
+    }
+
+    static bool Holds(Node* node, const SharedPtr<T, Policy>& value) {
+        if (!node) {
+            return !value.block_;
+        }
+        return node->value.block_ == value.block_ && node->value.ptr_ == value.ptr_;
+    }
+
+    // Returns the word with our external reference added, or 0 if the value is empty.
+    uint64_t AcquireExternal() const {
+        uint64_t current = word_.load(std::memory_order_relaxed);
+        while (Unpack(current)) {
+            if (word_.compare_exchange_weak(current, current + kExternalOne,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+                return current + kExternalOne;
+            }
+        }
+        return 0;
+    }
+
+    void ReleaseExternal(Node* node) const {
+        if (!node) {
+            return;
+        }
+        uint64_t current = word_.load(std::memory_order_relaxed);
+        while (Unpack(current) == node) {
+            if (word_.compare_exchange_weak(current, current - kExternalOne,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        // The node was swapped out and a writer has taken over our external reference.
+        if (node->internal.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete node;
+        }
+    }
+
+    static void RetireNode(Node* node, int64_t external) {
+        if (node->internal.fetch_add(external, std::memory_order_acq_rel) + external == 0) {
+            delete node;
+        }
+    }
+
+    mutable std::atomic<uint64_t> word_{0};
+};
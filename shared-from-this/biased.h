@@ -0,0 +1,213 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Biased reference counting policy.
+//
+// The thread that creates a block owns it and counts its own references with plain loads and
+// stores. Other threads use an atomic "shared" word holding their count (which may go negative)
+// shifted left by two, a "queued" bit and a "merged" bit. When the owner drops its last reference
+// it merges: from then on everyone uses the shared word. When another thread pushes the shared
+// count below zero, the block is queued to its owner, who merges it at its next release, or at
+// exit. The object dies when the shared word reads "merged, zero, not queued".
+
+struct BiasedCounting;
+
+// Per-thread owner record. Holds the queue of blocks waiting for their owner to merge them, and
+// stays alive until its thread has exited and no block names it as owner.
+class BiasedThread {
+public:
+    static BiasedThread* Current() {
+        if (!current) {
+            Attach();
+        }
+        return current;
+    }
+    static BiasedThread* CurrentOrNull() {
+        return current;
+    }
+
+    void AddRef() {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void Release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    // Returns false if the owner has exited, and the caller has to merge the block itself.
+    bool Push(BiasedCounting* block);
+
+    // Merges every queued block. Called by the owner thread only.
+    void MergeQueued() {
+        if (queue_.load(std::memory_order_relaxed)) {
+            MergeList(queue_.exchange(nullptr, std::memory_order_acquire));
+        }
+    }
+
+private:
+    struct ExitGuard {
+        ~ExitGuard() {
+            BiasedThread* self = current;
+            current = nullptr;
+            self->MergeList(self->queue_.exchange(Closed(), std::memory_order_acq_rel));
+            self->Release();
+        }
+    };
+
+    static void Attach() {
+        static thread_local ExitGuard guard;
+        current = new BiasedThread;
+    }
+
+    static BiasedCounting* Closed() {
+        return reinterpret_cast<BiasedCounting*>(uintptr_t{1});
+    }
+
+    static void MergeList(BiasedCounting* head);
+
+    std::atomic<size_t> refs_{1};
+    std::atomic<BiasedCounting*> queue_{nullptr};
+
+    inline static thread_local BiasedThread* current = nullptr;
+};
+
+struct BiasedCounting {
+    static constexpr bool kHasWeak = true;
+
+    BiasedCounting() : owner(BiasedThread::Current()) {
+        owner->AddRef();
+    }
+    BiasedCounting(const BiasedCounting&) = delete;
+    BiasedCounting& operator=(const BiasedCounting&) = delete;
+    ~BiasedCounting() {
+        owner->Release();
+    }
+
+    void IncStrong() {
+        if (owner == BiasedThread::CurrentOrNull() && !merged_by_owner) {
+            biased.store(biased.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        shared.fetch_add(kOne, std::memory_order_relaxed);
+    }
+    // The object dies only once the shared word settles on "merged, zero, not queued", so until
+    // then a new reference keeps it alive, even if every other one is gone and the block queued.
+    bool IncStrongIfNonZero() {
+        if (owner == BiasedThread::CurrentOrNull() && !merged_by_owner) {
+            biased.store(biased.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+        int64_t old = shared.load(std::memory_order_relaxed);
+        do {
+            if (old == kMerged) {
+                return false;
+            }
+        } while (!shared.compare_exchange_weak(old, old + kOne, std::memory_order_relaxed));
+        return true;
+    }
+    bool DecStrong() {
+        if (owner == BiasedThread::CurrentOrNull()) {
+            owner->MergeQueued();
+            if (!merged_by_owner) {
+                int64_t now = biased.load(std::memory_order_relaxed) - 1;
+                biased.store(now, std::memory_order_relaxed);
+                if (now != 0) {
+                    return false;
+                }
+                merged_by_owner = true;
+                return Settle(kMerged);
+            }
+        }
+        return DecShared();
+    }
+    void IncWeak() {
+        cnt_weak.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool DecWeak() {
+        if (cnt_weak.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    size_t StrongCount() const {
+        return biased.load(std::memory_order_relaxed) +
+               (shared.load(std::memory_order_relaxed) >> kFlagBits);
+    }
+
+    // Folds the owner's count into the shared word and takes the block off the queue.
+    // Runs on the owner thread, or on any thread once the owner has exited.
+    // Returns true if that released the last reference.
+    bool MergeQueuedBlock() {
+        int64_t delta = -kQueued;
+        if (!merged_by_owner) {
+            merged_by_owner = true;
+            delta += biased.load(std::memory_order_relaxed) * kOne + kMerged;
+            biased.store(0, std::memory_order_relaxed);
+        }
+        return Settle(delta);
+    }
+
+    static constexpr int kFlagBits = 2;
+    static constexpr int64_t kMerged = 1;
+    static constexpr int64_t kQueued = 2;
+    static constexpr int64_t kOne = int64_t{1} << kFlagBits;
+
+    BiasedThread* owner;
+    std::atomic<int64_t> biased{1};
+    bool merged_by_owner = false;
+    std::atomic<int64_t> shared{0};
+    std::atomic<size_t> cnt_weak{1};
+    BiasedCounting* next_queued = nullptr;
+
+private:
+    bool Settle(int64_t delta) {
+        return shared.fetch_add(delta, std::memory_order_acq_rel) + delta == kMerged;
+    }
+
+    bool DecShared() {
+        int64_t old = shared.load(std::memory_order_relaxed);
+        int64_t now;
+        do {
+            now = old - kOne;
+            if (now < 0 && !(now & (kMerged | kQueued))) {
+                now |= kQueued;
+            }
+        } while (!shared.compare_exchange_weak(old, now, std::memory_order_acq_rel,
+                                               std::memory_order_relaxed));
+        if (now == kMerged) {
+            return true;
+        }
+        if ((now & kQueued) && !(old & kQueued) && !owner->Push(this)) {
+            return MergeQueuedBlock();
+        }
+        return false;
+    }
+};
+
+inline bool BiasedThread::Push(BiasedCounting* block) {
+    BiasedCounting* head = queue_.load(std::memory_order_acquire);
+    do {
+        if (head == Closed()) {
+            return false;
+        }
+        block->next_queued = head;
+    } while (!queue_.compare_exchange_weak(head, block, std::memory_order_release,
+                                           std::memory_order_acquire));
+    return true;
+}
+
+inline void BiasedThread::MergeList(BiasedCounting* head) {
+    while (head) {
+        BiasedCounting* next = head->next_queued;
+        if (head->MergeQueuedBlock()) {
+            static_cast<BlockBase<BiasedCounting>*>(head)->Release();
+        }
+        head = next;
+    }
+}
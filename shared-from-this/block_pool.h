@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Per-thread free lists of control blocks, one for each kGranularity-byte size class up to
+// kMaxSize. A freed block goes to the list of the thread that frees it, and each list keeps at
+// most kMaxCached blocks; the rest, and anything bigger than kMaxSize, go to the global allocator.
+// Lists are thread-local, so taking and returning blocks needs no synchronization.
+class BlockPool {
+public:
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxSize = 128;
+    static constexpr size_t kMaxCached = 256;
+
+    static void* Allocate(size_t size) {
+        if (size > kMaxSize) {
+            return ::operator new(size);
+        }
+        // Always the full class size: the block may end up on any list of its class
+        Cache* cache = Local();
+        if (!cache || !cache->lists[Class(size)].head) {
+            return ::operator new(ClassSize(size));
+        }
+        FreeList& list = cache->lists[Class(size)];
+        FreeNode* node = list.head;
+        list.head = node->next;
+        --list.size;
+        return node;
+    }
+
+    static void Deallocate(void* ptr, size_t size) {
+        Cache* cache = Local();
+        if (size > kMaxSize || !cache) {
+            ::operator delete(ptr);
+            return;
+        }
+        FreeList& list = cache->lists[Class(size)];
+        if (list.size == kMaxCached) {
+            ::operator delete(ptr);
+            return;
+        }
+        list.head = new (ptr) FreeNode{list.head};
+        ++list.size;
+    }
+
+    // Blocks of this size class cached by the calling thread
+    static size_t CachedCount(size_t size) {
+        Cache* cache = Local();
+        return cache ? cache->lists[Class(size)].size : 0;
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct FreeList {
+        FreeNode* head = nullptr;
+        size_t size = 0;
+    };
+
+    struct Cache {
+        ~Cache() {
+            cache_destroyed = true;
+            for (FreeList& list : lists) {
+                while (FreeNode* node = list.head) {
+                    list.head = node->next;
+                    ::operator delete(node);
+                }
+            }
+        }
+
+        FreeList lists[kMaxSize / kGranularity];
+    };
+
+    static size_t Class(size_t size) {
+        return (size - 1) / kGranularity;
+    }
+    static size_t ClassSize(size_t size) {
+        return (Class(size) + 1) * kGranularity;
+    }
+
+    // Null once the thread's cache is destroyed: blocks freed by later thread-local or static
+    // destructors bypass the pool.
+    static Cache* Local() {
+        if (cache_destroyed) {
+            return nullptr;
+        }
+        static thread_local Cache cache;
+        return &cache;
+    }
+
+    inline static thread_local bool cache_destroyed = false;
+};
+
+// Base of the control blocks that SharedPtr allocates with `new`: routes their allocation through
+// BlockPool. Over-aligned blocks go straight to the global allocator.
+struct PooledBlock {
+    static void* operator new(size_t size) {
+        return BlockPool::Allocate(size);
+    }
+    static void operator delete(void* ptr, size_t size) {
+        BlockPool::Deallocate(ptr, size);
+    }
+    static void* operator new(size_t size, std::align_val_t align) {
+        return ::operator new(size, align);
+    }
+    static void operator delete(void* ptr, size_t, std::align_val_t align) {
+        ::operator delete(ptr, align);
+    }
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// Reference counting policies for SharedPtr / WeakPtr, picked at compile time by their second
+// template argument. A policy holds the counters and is the base of the control block.
+// DecStrong/DecWeak return true when the count they changed has reached zero.
+// IncStrongIfNonZero is how a WeakPtr gets a strong reference: it fails, without changing
+// anything, once the strong count is zero, so an object that is being destroyed stays dead.
+//
+// The weak count includes one reference held by all the strong ones together, so the block is
+// freed by whoever drops the weak count to zero and strong/weak releases never race.
+
+// Plain counters for pointers that never leave their thread.
+struct NonAtomicCounting {
+    static constexpr bool kHasWeak = true;
+
+    void IncStrong() {
+        ++cnt;
+    }
+    bool IncStrongIfNonZero() {
+        if (cnt == 0) {
+            return false;
+        }
+        ++cnt;
+        return true;
+    }
+    bool DecStrong() {
+        return --cnt == 0;
+    }
+    void IncWeak() {
+        ++cnt_weak;
+    }
+    bool DecWeak() {
+        return --cnt_weak == 0;
+    }
+    size_t StrongCount() const {
+        return cnt;
+    }
+
+    size_t cnt{1};
+    size_t cnt_weak{1};
+};
+
+// Increments are relaxed: a new reference can only be made from an existing one.
+// Decrements release, and the one that hits zero acquires before destroying.
+struct AtomicCounting {
+    static constexpr bool kHasWeak = true;
+
+    void IncStrong() {
+        cnt.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool IncStrongIfNonZero() {
+        size_t old = cnt.load(std::memory_order_relaxed);
+        do {
+            if (old == 0) {
+                return false;
+            }
+        } while (!cnt.compare_exchange_weak(old, old + 1, std::memory_order_relaxed));
+        return true;
+    }
+    bool DecStrong() {
+        if (cnt.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    void IncWeak() {
+        cnt_weak.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool DecWeak() {
+        if (cnt_weak.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    size_t StrongCount() const {
+        return cnt.load(std::memory_order_relaxed);
+    }
+
+    std::atomic<size_t> cnt{1};
+    std::atomic<size_t> cnt_weak{1};
+};
+
+// Atomic strong count only. WeakPtr and EnableSharedFromThis are not available, and the last
+// strong release frees the block without touching a second counter.
+struct NoWeakCounting {
+    static constexpr bool kHasWeak = false;
+
+    void IncStrong() {
+        cnt.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool IncStrongIfNonZero() {
+        size_t old = cnt.load(std::memory_order_relaxed);
+        do {
+            if (old == 0) {
+                return false;
+            }
+        } while (!cnt.compare_exchange_weak(old, old + 1, std::memory_order_relaxed));
+        return true;
+    }
+    bool DecStrong() {
+        if (cnt.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    bool DecWeak() {
+        return true;
+    }
+    size_t StrongCount() const {
+        return cnt.load(std::memory_order_relaxed);
+    }
+
+    std::atomic<size_t> cnt{1};
+};
+
+// Layout shared by the packed policies: both counts in one 64-bit word, the strong count in the
+// low half and the weak count in the high half. The object has expired when the strong half is
+// zero. A count that would overflow its 32 bits aborts the program rather than spill into the
+// other half.
+struct PackedLayout {
+    static constexpr int kHalfBits = 32;
+    static constexpr uint64_t kStrongOne = 1;
+    static constexpr uint64_t kWeakOne = uint64_t{1} << kHalfBits;
+    static constexpr uint64_t kHalfMax = kWeakOne - 1;
+
+    static uint64_t Strong(uint64_t word) {
+        return word & kHalfMax;
+    }
+    static uint64_t Weak(uint64_t word) {
+        return word >> kHalfBits;
+    }
+    static void CheckIncrement(uint64_t count) {
+        if (count == kHalfMax) {
+            std::abort();
+        }
+    }
+};
+
+// Half the size of NonAtomicCounting, for lots of small single-threaded objects.
+struct PackedCounting : PackedLayout {
+    static constexpr bool kHasWeak = true;
+
+    void IncStrong() {
+        CheckIncrement(Strong(word));
+        word += kStrongOne;
+    }
+    bool IncStrongIfNonZero() {
+        if (Strong(word) == 0) {
+            return false;
+        }
+        IncStrong();
+        return true;
+    }
+    bool DecStrong() {
+        word -= kStrongOne;
+        return Strong(word) == 0;
+    }
+    void IncWeak() {
+        CheckIncrement(Weak(word));
+        word += kWeakOne;
+    }
+    bool DecWeak() {
+        word -= kWeakOne;
+        return Weak(word) == 0;
+    }
+    size_t StrongCount() const {
+        return Strong(word);
+    }
+
+    uint64_t word{kStrongOne | kWeakOne};
+};
+
+// Half the size of AtomicCounting. Every update is one fetch_add/fetch_sub on the shared word,
+// with the same orderings as AtomicCounting; overflow is checked on the value it returns.
+struct PackedAtomicCounting : PackedLayout {
+    static constexpr bool kHasWeak = true;
+
+    void IncStrong() {
+        CheckIncrement(Strong(word.fetch_add(kStrongOne, std::memory_order_relaxed)));
+    }
+    bool IncStrongIfNonZero() {
+        uint64_t old = word.load(std::memory_order_relaxed);
+        do {
+            if (Strong(old) == 0) {
+                return false;
+            }
+            CheckIncrement(Strong(old));
+        } while (!word.compare_exchange_weak(old, old + kStrongOne, std::memory_order_relaxed));
+        return true;
+    }
+    bool DecStrong() {
+        if (Strong(word.fetch_sub(kStrongOne, std::memory_order_release)) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    void IncWeak() {
+        CheckIncrement(Weak(word.fetch_add(kWeakOne, std::memory_order_relaxed)));
+    }
+    bool DecWeak() {
+        if (Weak(word.fetch_sub(kWeakOne, std::memory_order_release)) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    size_t StrongCount() const {
+        return Strong(word.load(std::memory_order_relaxed));
+    }
+
+    std::atomic<uint64_t> word{kStrongOne | kWeakOne};
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Deferred destruction policy.
+//
+// Counts like AtomicCounting, but the release that drops the strong count to zero does not destroy
+// the object: it pushes the block onto a lock-free queue and returns. A background reclaimer
+// thread, started on first use, destroys queued objects in the order they were released. Objects
+// released by the reclaimer itself, such as the rest of a graph being torn down, die right away.
+// The reclaimer sleeps while the queue is empty; the releasing thread only locks, to wake it, when
+// it pushes onto an empty queue with the reclaimer asleep.
+//
+// Until the reclaimer gets to it, a queued object is expired: UseCount() is zero and WeakPtr::Lock
+// fails. Use it for pointers whose last release happens on a latency-sensitive path.
+
+struct DeferredCounting;
+
+class Reclaimer {
+public:
+    // Queues a block whose strong count has dropped to zero. Returns false if the reclaimer has
+    // already shut down and the caller has to release the block itself.
+    static bool Push(DeferredCounting* block);
+
+    // Waits until every block queued before the call is released. On the reclaimer thread, that
+    // is from the destructor of a deferred object, it cannot wait for the batch being released:
+    // it releases the blocks still queued itself and returns.
+    static void Flush() {
+        Reclaimer& self = Instance();
+        if (OnReclaimerThread()) {
+            self.Reclaimed(ReleaseList(self.queue_.exchange(nullptr, std::memory_order_acquire)));
+            return;
+        }
+        uint64_t target = self.pushed_.load(std::memory_order_acquire);
+        std::unique_lock guard(self.lock_);
+        self.drained_.wait(guard, [&] {
+            return self.reclaimed_.load(std::memory_order_acquire) >= target;
+        });
+    }
+
+    static bool OnReclaimerThread() {
+        return on_reclaimer;
+    }
+
+private:
+    ~Reclaimer() {
+        {
+            std::lock_guard guard(lock_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        // Blocks pushed since the thread stopped, by static destructors
+        shut_down.store(true, std::memory_order_release);
+        ReleaseList(queue_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    static Reclaimer& Instance() {
+        static Reclaimer instance;
+        return instance;
+    }
+
+    void Start() {
+        std::call_once(started_, [this] { thread_ = std::thread([this] { Run(); }); });
+    }
+
+    // Before sleeping the reclaimer raises sleeping_ and checks the queue again, while Push
+    // checks sleeping_ after pushing: with both sequentially consistent, either the reclaimer
+    // sees the block or Push sees it asleep and wakes it.
+    void Run() {
+        on_reclaimer = true;
+        while (true) {
+            if (DeferredCounting* head = queue_.exchange(nullptr, std::memory_order_acquire)) {
+                Reclaimed(ReleaseList(head));
+                continue;
+            }
+            std::unique_lock guard(lock_);
+            sleeping_.store(true);
+            wake_.wait(guard, [&] { return stop_ || queue_.load() != nullptr; });
+            sleeping_.store(false, std::memory_order_relaxed);
+            if (stop_) {
+                return;
+            }
+        }
+    }
+
+    void Reclaimed(uint64_t released) {
+        std::lock_guard guard(lock_);
+        reclaimed_.fetch_add(released, std::memory_order_release);
+        drained_.notify_all();
+    }
+
+    static uint64_t ReleaseList(DeferredCounting* head);
+
+    std::atomic<DeferredCounting*> queue_{nullptr};
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> reclaimed_{0};
+    std::atomic<bool> sleeping_{false};
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    bool stop_ = false;
+    std::once_flag started_;
+    std::thread thread_;
+
+    inline static std::atomic<bool> shut_down{false};
+    inline static thread_local bool on_reclaimer = false;
+};
+
+struct DeferredCounting : AtomicCounting {
+    bool DecStrong() {
+        if (!AtomicCounting::DecStrong()) {
+            return false;
+        }
+        return Reclaimer::OnReclaimerThread() || !Reclaimer::Push(this);
+    }
+
+    DeferredCounting* next_deferred = nullptr;
+};
+
+inline bool Reclaimer::Push(DeferredCounting* block) {
+    if (shut_down.load(std::memory_order_acquire)) {
+        return false;
+    }
+    Reclaimer& self = Instance();
+    self.Start();
+    self.pushed_.fetch_add(1, std::memory_order_relaxed);
+    DeferredCounting* head = self.queue_.load(std::memory_order_relaxed);
+    do {
+        block->next_deferred = head;
+    } while (!self.queue_.compare_exchange_weak(head, block, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed));
+    if (self.sleeping_.load()) {
+        std::lock_guard guard(self.lock_);
+        self.wake_.notify_one();
+    }
+    return true;
+}
+
+inline uint64_t Reclaimer::ReleaseList(DeferredCounting* head) {
+    // Pushed newest first: reverse to release in order
+    DeferredCounting* ordered = nullptr;
+    while (head) {
+        DeferredCounting* next = head->next_deferred;
+        head->next_deferred = ordered;
+        ordered = head;
+        head = next;
+    }
+    uint64_t released = 0;
+    while (ordered) {
+        DeferredCounting* next = ordered->next_deferred;
+        static_cast<BlockBase<DeferredCounting>*>(ordered)->Release();
+        ordered = next;
+        ++released;
+    }
+    return released;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Expiry notifications.
+//
+// ExpiryCounting<Base> counts like Base and adds to the control block the head of an intrusive
+// list of ExpiryListeners. The release that drops the strong count to zero calls each listener
+// once, right before the object is destroyed, so a weak-keyed index can drop its entry the moment
+// the object dies instead of scanning for dead ones. A block with no listeners pays one relaxed
+// load on its last release; blocks of the other policies pay nothing.
+//
+// Base has to release the object on the DecStrong that returns true: AtomicCounting,
+// NonAtomicCounting or a packed policy. DeferredCounting and BiasedCounting release some objects
+// from elsewhere, their reclaimer or a merge of queued decrements, and are refused.
+
+struct DeferredCounting;
+struct BiasedCounting;
+
+template <typename Base>
+class ExpiryListener;
+
+template <typename Base = AtomicCounting>
+struct ExpiryCounting : Base {
+    static_assert(Base::kHasWeak, "listeners hold weak references to the block");
+    static_assert(!std::is_base_of_v<DeferredCounting, Base> &&
+                      !std::is_base_of_v<BiasedCounting, Base>,
+                  "Base releases objects outside DecStrong, and the listeners would not run");
+
+    using Listener = ExpiryListener<Base>;
+
+    bool DecStrong() {
+        if (!Base::DecStrong()) {
+            return false;
+        }
+        // Listeners are added by holders of a strong reference, so every Listen happened before
+        // this release; a concurrent Remove leaves the lock bit set until it is done
+        if (listeners.load(std::memory_order_relaxed) != 0) {
+            Notify();
+        }
+        return true;
+    }
+
+    // The list is guarded by the low bit of its head, listeners being aligned
+    static constexpr uintptr_t kLocked = 1;
+
+    void Lock() {
+        uintptr_t head = listeners.load(std::memory_order_relaxed);
+        while (true) {
+            if (head & kLocked) {
+                std::this_thread::yield();
+                head = listeners.load(std::memory_order_relaxed);
+            } else if (listeners.compare_exchange_weak(head, head | kLocked,
+                                                       std::memory_order_acquire,
+                                                       std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+    void Unlock() {
+        listeners.store(listeners.load(std::memory_order_relaxed) & ~kLocked,
+                        std::memory_order_release);
+    }
+    // Whether the calling thread holds the lock, running the listeners of this block
+    bool Notifying() const {
+        return notifying == this;
+    }
+
+    Listener* Head() const {
+        return reinterpret_cast<Listener*>(listeners.load(std::memory_order_relaxed) & ~kLocked);
+    }
+    void SetHead(Listener* head) {
+        listeners.store(reinterpret_cast<uintptr_t>(head) | kLocked, std::memory_order_relaxed);
+    }
+
+    void Link(Listener* listener) {
+        Listener* head = Head();
+        listener->next_ = head;
+        listener->prev_ = nullptr;
+        if (head) {
+            head->prev_ = listener;
+        }
+        SetHead(listener);
+        listener->linked_ = true;
+    }
+    void Unlink(Listener* listener) {
+        if (listener->prev_) {
+            listener->prev_->next_ = listener->next_;
+        } else {
+            SetHead(listener->next_);
+        }
+        if (listener->next_) {
+            listener->next_->prev_ = listener->prev_;
+        }
+        listener->prev_ = listener->next_ = nullptr;
+        listener->linked_ = false;
+    }
+
+    // Pops the listeners one by one and calls them with the lock held, so that a Remove on
+    // another thread waits for a running callback, and one from the callback itself, found by
+    // Notifying(), goes ahead without the lock
+    void Notify() {
+        Lock();
+        const void* outer = std::exchange(notifying, this);
+        while (Listener* listener = Head()) {
+            Unlink(listener);
+            listener->callback_(listener);
+        }
+        notifying = outer;
+        Unlock();
+    }
+
+    std::atomic<uintptr_t> listeners{0};
+
+    inline static thread_local const void* notifying = nullptr;
+};
+
+// A callback to run when the object owned by a SharedPtr<T, ExpiryCounting<Base>> dies. Embed it
+// in the entry to evict and recover the entry from the listener passed to the callback.
+//
+// A listener holds a weak reference to the block it listens to, until Remove() or its
+// destruction. Its callback runs on the thread that drops the last strong reference, with the
+// listeners of that block locked: it may Remove any listener of the same block, but removing a
+// listener of another block that is expiring at the same time can deadlock.
+template <typename Base = AtomicCounting>
+class ExpiryListener {
+public:
+    using Policy = ExpiryCounting<Base>;
+    using Callback = void (*)(ExpiryListener*);
+
+    explicit ExpiryListener(Callback callback) : callback_(callback) {
+    }
+
+    ExpiryListener(const ExpiryListener&) = delete;
+    ExpiryListener& operator=(const ExpiryListener&) = delete;
+
+    ~ExpiryListener() {
+        Remove();
+    }
+
+    // Listens to the block of `ptr`, after removing the listener from the block it listened to.
+    // An empty `ptr` leaves the listener unattached.
+    template <typename T>
+    void Listen(const SharedPtr<T, Policy>& ptr) {
+        Remove();
+        if (!ptr.block_) {
+            return;
+        }
+        block_ = ptr.block_;
+        block_->IncWeakRef();
+        block_->Lock();
+        block_->Link(this);
+        block_->Unlock();
+    }
+
+    // Detaches the listener. Returns false if it was not listening or its callback has already
+    // run; once Remove returns, the callback is not running on any other thread.
+    bool Remove() {
+        if (!block_) {
+            return false;
+        }
+        bool nested = block_->Notifying();
+        if (!nested) {
+            block_->Lock();
+        }
+        bool linked = linked_;
+        if (linked) {
+            block_->Unlink(this);
+        }
+        if (!nested) {
+            block_->Unlock();
+        }
+        std::exchange(block_, nullptr)->DecWeakRef();
+        return linked;
+    }
+
+private:
+    friend Policy;
+
+    Callback callback_;
+    BlockBase<Policy>* block_ = nullptr;
+    ExpiryListener* prev_ = nullptr;
+    ExpiryListener* next_ = nullptr;
+    bool linked_ = false;
+};
@@ -1,65 +1,294 @@
 #pragma once
 
 #include "sw_fwd.h"  // Forward declaration
+#include "block_pool.h"
+
+#include <common/ptr_stats.h>
 
 #include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <functional>  // std::less, std::hash
 #include <iostream>
+#include <memory>  // std::allocator_traits
+#include <new>
+#include <type_traits>
 
-struct BlockBase {
-    size_t cnt{1};
-    size_t cnt_weak{0};
-    bool deleted = false;
-    virtual ~BlockBase() = default;
-    virtual void DeletePtr(bool fck = false) = 0;
+// What the dispatch function of a control block is asked to do
+enum class BlockOp {
+    kRelease,            // the strong count hit zero: destroy the object, then drop the weak
+                         // reference the strong ones held together
+    kFreeBlock,          // the weak count hit zero: free the block itself
+    kGetObject,          // return the address of the object the block owns, for ThinWeakPtr
+    kGetSharedFromThis,  // the same object, as the T of its EnableSharedFromThis<T> base
 };
 
-template <typename T>
-class Block : public BlockBase {
-public:
-    explicit Block(T* ptr) : ptr(ptr) {
+// Control blocks carry one function pointer instead of a vtable: no virtual destructor, and the
+// last release is a single indirect call that destroys the object and frees the block.
+template <typename Policy>
+struct BlockBase : Policy {
+    using Dispatch = void* (*)(BlockBase*, BlockOp);
+
+    explicit BlockBase(Dispatch dispatch) : dispatch(dispatch) {
     }
-    ~Block() override {
-        if (!deleted) {
-            deleted = true;
-            delete ptr;
-            ptr = nullptr;
+
+    void IncRef() {
+        this->IncStrong();
+    }
+    // Takes a strong reference unless the object has expired
+    bool TryIncRef() {
+        return this->IncStrongIfNonZero();
+    }
+    void DecRef() {
+        if (this->DecStrong()) {
+            Release();
+        }
+    }
+    void IncWeakRef() {
+        static_assert(Policy::kHasWeak, "the counting policy has no weak count");
+        this->IncWeak();
+    }
+    void DecWeakRef() {
+        if (this->DecWeak()) {
+            dispatch(this, BlockOp::kFreeBlock);
+        }
+    }
+    // Called once the strong count has dropped to zero
+    void Release() {
+        dispatch(this, BlockOp::kRelease);
+    }
+    size_t UseCount() const {
+        return this->StrongCount();
+    }
+    // The object the block owns, as its own type: a SharedPtr converted to a base class may hold
+    // another address
+    void* Object() {
+        return dispatch(this, BlockOp::kGetObject);
+    }
+    void* SharedFromThisObject() {
+        return dispatch(this, BlockOp::kGetSharedFromThis);
+    }
+
+    Dispatch dispatch;
+};
+
+// Dispatch function of block type `B`, which provides DestroyObject(), FreeBlock() and Get()
+template <typename B, typename Policy>
+void* DispatchBlock(BlockBase<Policy>* base, BlockOp op) {
+    auto block = static_cast<B*>(base);
+    switch (op) {
+        case BlockOp::kRelease:
+            block->DestroyObject();
+            if (!block->DecWeak()) {
+                return nullptr;
+            }
+            [[fallthrough]];
+        case BlockOp::kFreeBlock:
+            block->FreeBlock();
+            return nullptr;
+        case BlockOp::kGetObject:
+            return const_cast<void*>(static_cast<const void*>(block->Get()));
+        case BlockOp::kGetSharedFromThis: {
+            using Object = std::remove_cv_t<std::remove_pointer_t<decltype(block->Get())>>;
+            if constexpr (std::is_base_of_v<ESFTBase, Object>) {
+                return static_cast<typename Object::SharedFromThisType*>(
+                    const_cast<Object*>(block->Get()));
+            }
+            return nullptr;
         }
     }
-    void DeletePtr(bool fck = false) override {
-        if (!deleted) {
-            deleted = true;
+    return nullptr;
+}
+
+// Owns a pointer made elsewhere: SharedPtr(T*), Reset(T*). Pooled, as it is allocated on every
+// adoption.
+template <typename T, typename Policy>
+class Block : public BlockBase<Policy>, public PooledBlock {
+public:
+    using Element = std::remove_extent_t<T>;
+
+    explicit Block(Element* ptr) : BlockBase<Policy>(&DispatchBlock<Block, Policy>), ptr(ptr) {
+        PTR_STATS(SharedPtr, T, Allocate);
+    }
+    void DestroyObject() {
+        PTR_STATS(SharedPtr, T, Release);
+        if constexpr (std::is_array_v<T>) {
+            delete[] ptr;
+        } else {
             delete ptr;
-            if (!fck) {
-                ptr = nullptr;
+        }
+    }
+    void FreeBlock() {
+        delete this;
+    }
+    Element* Get() {
+        return ptr;
+    }
+    Element* ptr;
+};
+
+// Asks BlockEmplace to default-initialize the object instead of value-initializing it
+struct ForOverwriteTag {};
+
+template <typename T, typename Policy>
+class BlockEmplace : public BlockBase<Policy> {
+public:
+    template <typename... Args>
+    BlockEmplace(Args&&... args) : BlockBase<Policy>(&DispatchBlock<BlockEmplace, Policy>) {
+        new (storage) T{std::forward<Args>(args)...};
+        PTR_STATS(SharedPtr, T, Allocate);
+    }
+    BlockEmplace(ForOverwriteTag) : BlockBase<Policy>(&DispatchBlock<BlockEmplace, Policy>) {
+        new (storage) T;
+        PTR_STATS(SharedPtr, T, Allocate);
+    }
+    void DestroyObject() {
+        PTR_STATS(SharedPtr, T, Release);
+        Get()->~T();
+    }
+    void FreeBlock() {
+        delete this;
+    }
+    T* Get() {
+        return reinterpret_cast<T*>(&storage);
+    }
+    alignas(T) char storage[sizeof(T)];
+};
+
+// Control block followed by `size` elements in the same allocation, for MakeShared<T[]>.
+// Elements start at a kAlignment boundary so that vector loads can use aligned instructions.
+template <typename T, typename Policy>
+class BlockArray : public BlockBase<Policy> {
+public:
+    static constexpr size_t kAlignment = alignof(T) > 64 ? alignof(T) : 64;
+
+    // Allocates the block and builds its elements; `for_overwrite` default-initializes them.
+    // Throws std::bad_array_new_length if the allocation size would overflow.
+    static BlockArray* Create(size_t size, bool for_overwrite) {
+        if (size > (SIZE_MAX - ElementsOffset()) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void* memory = ::operator new(ElementsOffset() + size * sizeof(T),
+                                      std::align_val_t{kAlignment});
+        auto block = new (memory) BlockArray(size);
+        size_t built = 0;
+        try {
+            for (; built < size; ++built) {
+                if (for_overwrite) {
+                    new (block->Get() + built) T;
+                } else {
+                    new (block->Get() + built) T();
+                }
             }
+        } catch (...) {
+            block->Destroy(built);
+            block->FreeBlock();
+            throw;
+        }
+        PTR_STATS(SharedPtr, T[], Allocate);
+        return block;
+    }
+
+    void DestroyObject() {
+        PTR_STATS(SharedPtr, T[], Release);
+        Destroy(size);
+    }
+    void FreeBlock() {
+        this->~BlockArray();
+        ::operator delete(this, std::align_val_t{kAlignment});
+    }
+    T* Get() {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + ElementsOffset());
+    }
+    size_t size;
+
+private:
+    explicit BlockArray(size_t size)
+        : BlockBase<Policy>(&DispatchBlock<BlockArray, Policy>), size(size) {
+    }
+
+    static constexpr size_t ElementsOffset() {
+        return (sizeof(BlockArray) + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    void Destroy(size_t count) {
+        while (count > 0) {
+            Get()[--count].~T();
         }
     }
+};
+
+// Keeps a possibly empty object (an allocator, a deleter) inside a block at no cost when it is
+// empty, same as CompressedPairElement in unique/compressed_pair.h.
+template <typename T, bool = std::is_empty_v<T> && !std::is_final_v<T>>
+struct EmptyBaseHolder {
+    EmptyBaseHolder(const T& val) : value(val) {
+    }
+    EmptyBaseHolder(T&& val) : value(std::move(val)) {
+    }
+    T& GetElement() {
+        return value;
+    }
+    T value;
+};
+
+template <typename T>
+struct EmptyBaseHolder<T, true> : private T {
+    EmptyBaseHolder(const T& val) : T(val) {
+    }
+    EmptyBaseHolder(T&& val) : T(std::move(val)) {
+    }
+    T& GetElement() {
+        return *this;
+    }
+};
+
+// Control block for a pointer released by a user deleter instead of `delete`
+template <typename T, typename Deleter, typename Policy>
+class BlockDeleter : public BlockBase<Policy>,
+                     public PooledBlock,
+                     private EmptyBaseHolder<Deleter> {
+public:
+    BlockDeleter(T* ptr, Deleter&& deleter)
+        : BlockBase<Policy>(&DispatchBlock<BlockDeleter, Policy>),
+          EmptyBaseHolder<Deleter>(std::move(deleter)),
+          ptr(ptr) {
+        PTR_STATS(SharedPtr, T, Allocate);
+    }
+    void DestroyObject() {
+        PTR_STATS(SharedPtr, T, Release);
+        this->GetElement()(ptr);
+    }
+    void FreeBlock() {
+        delete this;
+    }
     T* Get() {
         return ptr;
     }
     T* ptr;
 };
 
-template <typename T>
-class BlockEmplace : public BlockBase {
+// Object and control block in one allocation made by a user allocator, which the block keeps to
+// free itself.
+template <typename T, typename Alloc, typename Policy>
+class BlockAllocated : public BlockBase<Policy>, private EmptyBaseHolder<Alloc> {
 public:
+    using Allocator =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<BlockAllocated>;
+
     template <typename... Args>
-    BlockEmplace(Args&&... args) {
+    BlockAllocated(const Alloc& alloc, Args&&... args)
+        : BlockBase<Policy>(&DispatchBlock<BlockAllocated, Policy>), EmptyBaseHolder<Alloc>(alloc) {
         new (storage) T{std::forward<Args>(args)...};
+        PTR_STATS(SharedPtr, T, Allocate);
     }
-    ~BlockEmplace() override {
-        if (!deleted) {
-            deleted = true;
-            reinterpret_cast<T*>(&storage)->~T();
-        }
+    void DestroyObject() {
+        PTR_STATS(SharedPtr, T, Release);
+        Get()->~T();
     }
-    void DeletePtr(bool fck = false) override {
-        if (!deleted) {
-            deleted = true;
-            if (!fck) {
-                reinterpret_cast<T*>(&storage)->~T();
-            }
-        }
+    void FreeBlock() {
+        Allocator alloc(this->GetElement());
+        this->~BlockAllocated();
+        std::allocator_traits<Allocator>::deallocate(alloc, this, 1);
     }
     T* Get() {
         return reinterpret_cast<T*>(&storage);
@@ -68,76 +297,86 @@ public:
 };
 
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
-template <typename T>
+template <typename T, typename Policy>
 class SharedPtr {
 public:
+    using Element = std::remove_extent_t<T>;
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
-    T* ptr_ = nullptr;
+    Element* ptr_ = nullptr;
     SharedPtr() {
         block_ = nullptr;
     }
     SharedPtr(std::nullptr_t) {
         block_ = nullptr;
     }
-    explicit SharedPtr(T* ptr) {
-        block_ = new Block(ptr);
+    explicit SharedPtr(Element* ptr) {
+        block_ = new Block<T, Policy>(ptr);
         ptr_ = ptr;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            //            std::cout << "fck YOU\n";
-            ptr->weak_this = *this;
-        }
+        PTR_STATS(SharedPtr, T, Construct);
+        InitSharedFromThis();
     }
 
-    template <typename Y>
+    template <typename Y, typename U = T, typename = std::enable_if_t<!std::is_array_v<U>>>
     explicit SharedPtr(Y* ptr) {
-        block_ = new Block<Y>(ptr);
+        block_ = new Block<Y, Policy>(ptr);
         ptr_ = ptr;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            ptr->weak_this = *this;
+        PTR_STATS(SharedPtr, T, Construct);
+        InitSharedFromThis();
+    }
+
+    // `deleter(ptr)` is called instead of `delete ptr`, also if allocating the block throws
+    template <typename Y, typename Deleter,
+              typename = std::enable_if_t<std::is_invocable_v<Deleter&, Y*>>>
+    SharedPtr(Y* ptr, Deleter deleter) {
+        try {
+            block_ = new BlockDeleter<Y, Deleter, Policy>(ptr, std::move(deleter));
+        } catch (...) {
+            deleter(ptr);
+            throw;
         }
+        ptr_ = ptr;
+        PTR_STATS(SharedPtr, T, Construct);
+        InitSharedFromThis(true);
     }
 
-    explicit SharedPtr(BlockBase* bb, T* ptr, bool new_one = false) {
+    // Takes over the reference a new block starts with, or with `new_one` takes another one
+    // unless the object has expired, leaving the pointer empty if it has
+    explicit SharedPtr(BlockBase<Policy>* bb, Element* ptr, bool new_one = false) {
         block_ = bb;
         ptr_ = ptr;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            //            std::cout << "fck YOU\n";
-            if (ptr) {
-                ptr->weak_this = *this;
-            }
-        }
-        if (new_one) {
-            if (block_) {
-                if (block_->deleted) {
-                    ptr_ = nullptr;
-                }
-                block_->deleted = false;
-                ++block_->cnt;
+        if (!new_one) {
+            InitSharedFromThis();
+        } else if (block_) {
+            if (block_->TryIncRef()) {
+                PTR_STATS(SharedPtr, T, IncRef);
+            } else {
+                block_ = nullptr;
+                ptr_ = nullptr;
             }
         }
+        PTR_STATS_IF(block_, SharedPtr, T, Construct);
     }
 
     SharedPtr(const SharedPtr& other) {
         block_ = other.block_;
         ptr_ = other.ptr_;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            ptr_->weak_this = *this;
-        }
         if (block_) {
-            ++block_->cnt;
+            PTR_STATS(SharedPtr, T, Copy);
+            PTR_STATS(SharedPtr, T, IncRef);
+            block_->IncRef();
         }
     }
 
     template <typename Y>
-    SharedPtr(const SharedPtr<Y>& other) {
+    SharedPtr(const SharedPtr<Y, Policy>& other) {
         block_ = other.block_;
         ptr_ = other.ptr_;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            ptr_->weak_this = *this;
-        }
         if (block_) {
-            ++block_->cnt;
+            PTR_STATS(SharedPtr, T, Copy);
+            PTR_STATS(SharedPtr, T, IncRef);
+            block_->IncRef();
         }
     }
 
@@ -149,12 +388,10 @@ public:
     }*/
 
     template <typename Y>
-    SharedPtr<T>(SharedPtr<Y>&& other) {
+    SharedPtr(SharedPtr<Y, Policy>&& other) {
         block_ = other.block_;
         ptr_ = other.ptr_;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            ptr_->weak_this = ptr_;
-        }
+        PTR_STATS_IF(block_, SharedPtr, T, Move);
         other.block_ = nullptr;
         other.ptr_ = nullptr;
     }
@@ -162,32 +399,38 @@ public:
     // Aliasing constructor
     // #8 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     template <typename Y>
-    SharedPtr(const SharedPtr<Y>& other, T* ptr) {
+    SharedPtr(const SharedPtr<Y, Policy>& other, Element* ptr) {
         ptr_ = ptr;
         block_ = other.block_;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            ptr_->weak_this = *this;
-        }
         if (block_) {
-            ++block_->cnt;
+            PTR_STATS(SharedPtr, T, Copy);
+            PTR_STATS(SharedPtr, T, IncRef);
+            block_->IncRef();
         }
     }
 
+    // Same, but takes over the reference held by `other`, which is left empty: no counter is
+    // touched
+    template <typename Y>
+    SharedPtr(SharedPtr<Y, Policy>&& other, Element* ptr) {
+        ptr_ = ptr;
+        block_ = other.block_;
+        PTR_STATS_IF(block_, SharedPtr, T, Move);
+        other.block_ = nullptr;
+        other.ptr_ = nullptr;
+    }
+
     // Promote `WeakPtr`
     // #11 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
 
-    explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.block_->deleted) {
+    explicit SharedPtr(const WeakPtr<T, Policy>& other) {
+        if (!other.block_ || !other.block_->TryIncRef()) {
             throw BadWeakPtr();
         }
         block_ = other.block_;
         ptr_ = other.ptr_;
-        if constexpr (std::is_base_of_v<ESFTBase, T>) {
-            ptr_->weak_this = *this;
-        }
-        if (block_) {
-            ++block_->cnt;
-        }
+        PTR_STATS(SharedPtr, T, Construct);
+        PTR_STATS(SharedPtr, T, IncRef);
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -198,18 +441,22 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            PTR_STATS(SharedPtr, T, Copy);
+            PTR_STATS(SharedPtr, T, IncRef);
+            block_->IncRef();
         }
         return *this;
     }
 
     template <typename Y>
-    SharedPtr& operator=(const SharedPtr<Y>& other) {
+    SharedPtr& operator=(const SharedPtr<Y, Policy>& other) {
         Reset();
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            PTR_STATS(SharedPtr, T, Copy);
+            PTR_STATS(SharedPtr, T, IncRef);
+            block_->IncRef();
         }
         return *this;
     }
@@ -218,16 +465,18 @@ public:
         Reset();
         block_ = other.block_;
         ptr_ = other.ptr_;
+        PTR_STATS_IF(block_, SharedPtr, T, Move);
         other.block_ = nullptr;
         other.ptr_ = nullptr;
         return *this;
     }
 
     template <typename Y>
-    SharedPtr& operator=(SharedPtr<Y>&& other) {
+    SharedPtr& operator=(SharedPtr<Y, Policy>&& other) {
         Reset();
         block_ = other.block_;
         ptr_ = other.ptr_;
+        PTR_STATS_IF(block_, SharedPtr, T, Move);
         other.block_ = nullptr;
         other.ptr_ = nullptr;
         return *this;
@@ -244,38 +493,33 @@ public:
     // Modifiers
 
     void Reset() {
-        if (block_) {
-            --block_->cnt;
-            if (block_->cnt == 0 && block_->cnt_weak == 0) {
-                delete block_;
-            } else {
-                if (block_->cnt == 0) {
-                    if constexpr (std::is_base_of_v<ESFTBase, T>) {
-                        ++block_->cnt;
-                    }
-                    block_->DeletePtr();
-                    if constexpr (std::is_base_of_v<ESFTBase, T>) {
-                        --block_->cnt;
-                    }
-                    if (block_->cnt == 0 && block_->cnt_weak == 0) {
-                        delete block_;
-                    }
-                }
-            }
-        }
-        ptr_ = nullptr;
+        auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
+        if (prev) {
+            PTR_STATS(SharedPtr, T, Destroy);
+            PTR_STATS(SharedPtr, T, DecRef);
+            prev->DecRef();
+        }
     }
-    void Reset(T* ptr) {
+    void Reset(Element* ptr) {
         Reset();
-        block_ = new Block(ptr);
+        block_ = new Block<T, Policy>(ptr);
         ptr_ = ptr;
+        PTR_STATS(SharedPtr, T, Construct);
+        InitSharedFromThis();
     }
-    template <typename Y>
+    template <typename Y, typename U = T, typename = std::enable_if_t<!std::is_array_v<U>>>
     void Reset(Y* ptr) {
         Reset();
-        block_ = new Block<Y>(ptr);
+        block_ = new Block<Y, Policy>(ptr);
         ptr_ = ptr;
+        PTR_STATS(SharedPtr, T, Construct);
+        InitSharedFromThis();
+    }
+    template <typename Y, typename Deleter>
+    void Reset(Y* ptr, Deleter deleter) {
+        SharedPtr(ptr, std::move(deleter)).Swap(*this);
     }
     void Swap(SharedPtr& other) {
         std::swap(block_, other.block_);
@@ -285,59 +529,309 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const {
-        if (block_ && block_->deleted) {
-            return nullptr;
-        }
+    Element* Get() const {
         return ptr_;
     }
-    T& operator*() const {
+    Element& operator*() const {
         return *ptr_;
     }
-    T* operator->() const {
-        return Get();
+    Element* operator->() const {
+        return ptr_;
+    }
+    template <typename U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
+    Element& operator[](std::ptrdiff_t index) const {
+        return ptr_[index];
     }
     size_t UseCount() const {
         if (!block_) {
             return 0;
         }
-        return block_->cnt;
+        return block_->UseCount();
     }
     explicit operator bool() const {
-        return block_;
+        return ptr_ != nullptr;
+    }
+
+    // Order by control block, as std::shared_ptr::owner_before: pointers sharing ownership are
+    // equivalent, whatever they point to
+    template <typename Y>
+    bool OwnerBefore(const SharedPtr<Y, Policy>& other) const {
+        return std::less<BlockBase<Policy>*>()(block_, other.block_);
+    }
+    template <typename Y>
+    bool OwnerBefore(const WeakPtr<Y, Policy>& other) const {
+        return std::less<BlockBase<Policy>*>()(block_, other.block_);
+    }
+
+    BlockBase<Policy>* block_ = nullptr;
+
+private:
+    // Points an EnableSharedFromThis object at the block of its first owner. Only the
+    // constructors that take ownership of an object call it, so copies, conversions and
+    // promotions of a WeakPtr cost the same for these types as for any other.
+    // As std::enable_shared_from_this, an object that is still owned keeps its owner: only a
+    // new object, or one whose owners are all gone, such as one back from a pool, takes this one.
+    // `pin` is for blocks with a user deleter, the only ones that can leave the object alive
+    // after its owners: the object then holds a weak reference to tell they are gone.
+    void InitSharedFromThis(bool pin = false) {
+        if constexpr (std::is_base_of_v<ESFTBase, T>) {
+            if (!ptr_) {
+                return;
+            }
+            auto old = ptr_->ThisBlock();
+            // An unpinned block lives at least as long as the object it owns
+            if (old && (!ptr_->Pinned() || old->UseCount() != 0)) {
+                return;
+            }
+            if (pin) {
+                block_->IncWeakRef();
+            }
+            if (old) {
+                old->DecWeakRef();
+            }
+            ptr_->SetThisBlock(block_, pin);
+        }
     }
-    BlockBase* block_ = nullptr;
 };
 
-template <typename T, typename U>
-inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
+template <typename T, typename U, typename Policy>
+inline bool operator==(const SharedPtr<T, Policy>& left, const SharedPtr<U, Policy>& right) {
     return left.block_ == right.block_;
 }
 
+// Hash of an address for open-addressing tables. Blocks and objects are aligned, so the identity
+// hash of std::hash<T*> leaves the low bits, which pick the slot, always zero: mix them in
+// with the murmur3 finalizer.
+inline size_t HashPointer(const void* ptr) {
+    uint64_t bits = reinterpret_cast<uintptr_t>(ptr);
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+    return static_cast<size_t>(bits);
+}
+
+// Consistent with operator==, which compares control blocks
+namespace std {
+template <typename T, typename Policy>
+struct hash<SharedPtr<T, Policy>> {
+    size_t operator()(const SharedPtr<T, Policy>& ptr) const {
+        return HashPointer(ptr.block_);
+    }
+};
+}  // namespace std
+
+// Casts of the stored pointer that share ownership with `other`, like the std::*_pointer_cast
+// functions. The rvalue overloads steal the reference of `other` instead of adding one; a failed
+// DynamicPointerCast leaves `other` as it was.
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(const SharedPtr<U, Policy>& other) {
+    return SharedPtr<T, Policy>(other, static_cast<std::remove_extent_t<T>*>(other.Get()));
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(SharedPtr<U, Policy>&& other) {
+    auto ptr = static_cast<std::remove_extent_t<T>*>(other.Get());
+    return SharedPtr<T, Policy>(std::move(other), ptr);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(const SharedPtr<U, Policy>& other) {
+    if (auto ptr = dynamic_cast<std::remove_extent_t<T>*>(other.Get())) {
+        return SharedPtr<T, Policy>(other, ptr);
+    }
+    return SharedPtr<T, Policy>();
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(SharedPtr<U, Policy>&& other) {
+    if (auto ptr = dynamic_cast<std::remove_extent_t<T>*>(other.Get())) {
+        return SharedPtr<T, Policy>(std::move(other), ptr);
+    }
+    return SharedPtr<T, Policy>();
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(const SharedPtr<U, Policy>& other) {
+    return SharedPtr<T, Policy>(other, const_cast<std::remove_extent_t<T>*>(other.Get()));
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(SharedPtr<U, Policy>&& other) {
+    auto ptr = const_cast<std::remove_extent_t<T>*>(other.Get());
+    return SharedPtr<T, Policy>(std::move(other), ptr);
+}
+
+#ifndef SHARED_PTR_SEPARATE_PAYLOAD_BYTES
+#define SHARED_PTR_SEPARATE_PAYLOAD_BYTES SIZE_MAX
+#endif
+
+// MakeShared<T> and MakeSharedForOverwrite<T> put objects of at least this many bytes in their own
+// allocation, freed as soon as the strong count hits zero, so that a WeakPtr left behind pins only
+// the control block. Off by default; set it for all types with SHARED_PTR_SEPARATE_PAYLOAD_BYTES or
+// specialize it for one type.
+template <typename T>
+inline constexpr size_t kSeparatePayloadBytes = SHARED_PTR_SEPARATE_PAYLOAD_BYTES;
+
 // Allocate memory only once
-template <typename T, typename... Args>
-SharedPtr<T> MakeShared(Args&&... args);
+template <typename T, typename Policy = AtomicCounting, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeShared(Args&&... args);
+
+// `size` value-initialized elements in the same allocation as the control block
+template <typename T, typename Policy = AtomicCounting>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, SharedPtr<T, Policy>> MakeShared(
+    size_t size);
+
+// Same as MakeShared, but the object is default-initialized: trivial types are left
+// uninitialized for the caller to fill in
+template <typename T, typename Policy = AtomicCounting>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeSharedForOverwrite();
+
+template <typename T, typename Policy = AtomicCounting>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, SharedPtr<T, Policy>>
+MakeSharedForOverwrite(size_t size);
+
+// Same as MakeShared, but the single allocation comes from `alloc`
+template <typename T, typename Policy = AtomicCounting, typename Alloc, typename... Args>
+SharedPtr<T, Policy> AllocateShared(const Alloc& alloc, Args&&... args);
+
+// Whether `Base*` converts to `T*` with a static_cast: not through a virtual base
+template <typename T, typename Base, typename = void>
+inline constexpr bool kStaticDowncast = false;
+template <typename T, typename Base>
+inline constexpr bool
+    kStaticDowncast<T, Base, std::void_t<decltype(static_cast<T*>(std::declval<Base*>()))>> =
+        true;
 
 // Look for usage examples in tests and seminar
-template <typename T>
+//
+// The object keeps only the block of its first owner, without a weak reference: it dies with
+// its owners, and the block with it. Only an owner with a user deleter, which can put the object
+// back in a pool or leave a static one alone, takes a weak reference for it, dropped by the
+// object's destructor, so that the block stays valid to tell it has expired. The object pointer
+// is `this`, cast down to T; when EnableSharedFromThis is a virtual base of T the block casts it
+// instead, from the type of the object it owns. Until the first owner takes the object,
+// SharedFromThis and WeakFromThis return empty pointers.
+template <typename T, typename Policy = AtomicCounting>
 class EnableSharedFromThis : ESFTBase {
 public:
-    SharedPtr<T> SharedFromThis() {
-        return SharedPtr(weak_this.block_, weak_this.ptr_, true);
+    using SharedFromThisType = T;
+
+protected:
+    EnableSharedFromThis() {
+    }
+    // A copy is a new object, without an owner yet
+    EnableSharedFromThis(const EnableSharedFromThis&) {
+    }
+    EnableSharedFromThis& operator=(const EnableSharedFromThis&) {
+        return *this;
+    }
+    ~EnableSharedFromThis() {
+        if (Pinned()) {
+            ThisBlock()->DecWeakRef();
+        }
     }
-    SharedPtr<const T> SharedFromThis() const;
 
-    WeakPtr<T> WeakFromThis() noexcept {
-        return weak_this;
+public:
+    SharedPtr<T, Policy> SharedFromThis() {
+        if (!this_block) {
+            return SharedPtr<T, Policy>();
+        }
+        return SharedPtr<T, Policy>(ThisBlock(), const_cast<T*>(Self()), true);
+    }
+    SharedPtr<const T, Policy> SharedFromThis() const {
+        if (!this_block) {
+            return SharedPtr<const T, Policy>();
+        }
+        return SharedPtr<const T, Policy>(ThisBlock(), Self(), true);
     }
-    WeakPtr<const T> WeakFromThis() const noexcept {
-        return WeakPtr<const T>(weak_this);
+
+    WeakPtr<T, Policy> WeakFromThis() noexcept {
+        if (!this_block) {
+            return WeakPtr<T, Policy>();
+        }
+        return WeakPtr<T, Policy>(ThisBlock(), const_cast<T*>(Self()));
+    }
+    WeakPtr<const T, Policy> WeakFromThis() const noexcept {
+        if (!this_block) {
+            return WeakPtr<const T, Policy>();
+        }
+        return WeakPtr<const T, Policy>(ThisBlock(), Self());
+    }
+
+    BlockBase<Policy>* ThisBlock() const {
+        return reinterpret_cast<BlockBase<Policy>*>(this_block & ~kPinned);
+    }
+    bool Pinned() const {
+        return this_block & kPinned;
+    }
+    void SetThisBlock(BlockBase<Policy>* block, bool pinned) const {
+        this_block = reinterpret_cast<uintptr_t>(block) | (pinned ? kPinned : 0);
+    }
+
+    // The block of the first owner, set also for a const object. Blocks are aligned, and the low
+    // bit tells that the object holds a weak reference to its block.
+    static constexpr uintptr_t kPinned = 1;
+    mutable uintptr_t this_block = 0;
+
+private:
+    const T* Self() const {
+        if constexpr (kStaticDowncast<const T, const EnableSharedFromThis>) {
+            return static_cast<const T*>(this);
+        } else {
+            // The cast reads the object the block owns, which an expired block may have destroyed
+            if (ThisBlock()->UseCount() == 0) {
+                return nullptr;
+            }
+            return static_cast<const T*>(ThisBlock()->SharedFromThisObject());
+        }
     }
-    WeakPtr<T> weak_this;
 };
 
-template <typename T, typename... Args>
-SharedPtr<T> MakeShared(Args&&... args) {
-    auto block = new BlockEmplace<T>(std::forward<Args>(args)...);
-    return SharedPtr<T>(block, block->Get());
-}
\ No newline at end of file
+template <typename T, typename Policy, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeShared(Args&&... args) {
+    if constexpr (sizeof(T) >= kSeparatePayloadBytes<std::remove_cv_t<T>>) {
+        std::unique_ptr<T> object(new T{std::forward<Args>(args)...});
+        auto block = new Block<T, Policy>(object.get());
+        return SharedPtr<T, Policy>(block, object.release());
+    }
+    auto block = new BlockEmplace<T, Policy>(std::forward<Args>(args)...);
+    return SharedPtr<T, Policy>(block, block->Get());
+}
+
+template <typename T, typename Policy>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, SharedPtr<T, Policy>> MakeShared(
+    size_t size) {
+    auto block = BlockArray<std::remove_extent_t<T>, Policy>::Create(size, false);
+    return SharedPtr<T, Policy>(block, block->Get());
+}
+
+template <typename T, typename Policy>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeSharedForOverwrite() {
+    if constexpr (sizeof(T) >= kSeparatePayloadBytes<std::remove_cv_t<T>>) {
+        std::unique_ptr<T> object(new T);
+        auto block = new Block<T, Policy>(object.get());
+        return SharedPtr<T, Policy>(block, object.release());
+    }
+    auto block = new BlockEmplace<T, Policy>(ForOverwriteTag{});
+    return SharedPtr<T, Policy>(block, block->Get());
+}
+
+template <typename T, typename Policy>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, SharedPtr<T, Policy>>
+MakeSharedForOverwrite(size_t size) {
+    auto block = BlockArray<std::remove_extent_t<T>, Policy>::Create(size, true);
+    return SharedPtr<T, Policy>(block, block->Get());
+}
+
+template <typename T, typename Policy, typename Alloc, typename... Args>
+SharedPtr<T, Policy> AllocateShared(const Alloc& alloc, Args&&... args) {
+    using Block = BlockAllocated<T, Alloc, Policy>;
+    typename Block::Allocator block_alloc(alloc);
+    Block* block = std::allocator_traits<typename Block::Allocator>::allocate(block_alloc, 1);
+    try {
+        new (block) Block(alloc, std::forward<Args>(args)...);
+    } catch (...) {
+        std::allocator_traits<typename Block::Allocator>::deallocate(block_alloc, block, 1);
+        throw;
+    }
+    return SharedPtr<T, Policy>(block, block->Get());
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Per-thread slab heaps for small control blocks.
+//
+// A heap carves kSlabSize slabs into blocks of one kGranularity-byte size class each. The owner
+// thread takes and returns blocks through plain free lists. A block freed on another thread goes
+// onto an atomic list in its slab header, found by masking the block address, and the owner
+// collects those lists once its current slab runs out. When a thread exits its heap is retired
+// with all its slabs, and the next new thread takes it over, so slab memory is reused but never
+// given back to the system.
+class SlabHeap {
+public:
+    static constexpr size_t kSlabSize = 64 * 1024;
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxSize = 256;
+
+    static void* Allocate(size_t size, size_t align) {
+        if (size > kMaxSize || align > kGranularity) {
+            if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                return ::operator new(size, std::align_val_t{align});
+            }
+            return ::operator new(size);
+        }
+        if (SlabHeap* heap = Current()) {
+            return heap->Take(Class(size));
+        }
+        // Thread-local destructors of an exiting thread: borrow a retired heap
+        SlabHeap* heap = Acquire();
+        void* block = heap->Take(Class(size));
+        Retire(heap);
+        return block;
+    }
+
+    static void Deallocate(void* ptr, size_t size, size_t align) {
+        if (size > kMaxSize || align > kGranularity) {
+            if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                ::operator delete(ptr, std::align_val_t{align});
+            } else {
+                ::operator delete(ptr);
+            }
+            return;
+        }
+        Slab* slab = SlabOf(ptr);
+        SlabHeap* heap = Current();
+        if (heap && slab->owner == heap) {
+            heap->classes_[slab->size_class].free = new (ptr) FreeNode{
+                heap->classes_[slab->size_class].free};
+            return;
+        }
+        auto node = new (ptr) FreeNode{slab->remote.load(std::memory_order_relaxed)};
+        while (!slab->remote.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+        }
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct alignas(kGranularity) Slab {
+        SlabHeap* owner;
+        size_t size_class;
+        std::atomic<FreeNode*> remote{nullptr};
+        Slab* next;
+        char* bump;
+    };
+
+    struct ClassState {
+        FreeNode* free = nullptr;
+        Slab* slabs = nullptr;  // the first one is being carved
+    };
+
+    struct ExitGuard {
+        ~ExitGuard() {
+            SlabHeap* heap = current;
+            current = nullptr;
+            exiting = true;
+            Retire(heap);
+        }
+    };
+
+    static constexpr size_t kClasses = kMaxSize / kGranularity;
+
+    static size_t Class(size_t size) {
+        return size == 0 ? 0 : (size - 1) / kGranularity;
+    }
+    static size_t ClassSize(size_t size_class) {
+        return (size_class + 1) * kGranularity;
+    }
+    static Slab* SlabOf(void* ptr) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) & ~(kSlabSize - 1));
+    }
+
+    static SlabHeap* Current() {
+        if (!current && !exiting) {
+            static thread_local ExitGuard guard;
+            current = Acquire();
+        }
+        return current;
+    }
+
+    // Retired heaps outlive everything, so that blocks freed during static destruction still
+    // have somewhere to go
+    static std::mutex& RetiredLock() {
+        static auto lock = new std::mutex;
+        return *lock;
+    }
+    static std::vector<SlabHeap*>& Retired() {
+        static auto retired = new std::vector<SlabHeap*>;
+        return *retired;
+    }
+
+    static SlabHeap* Acquire() {
+        std::lock_guard guard(RetiredLock());
+        if (Retired().empty()) {
+            return new SlabHeap;
+        }
+        SlabHeap* heap = Retired().back();
+        Retired().pop_back();
+        return heap;
+    }
+    static void Retire(SlabHeap* heap) {
+        std::lock_guard guard(RetiredLock());
+        Retired().push_back(heap);
+    }
+
+    void* Take(size_t size_class) {
+        ClassState& state = classes_[size_class];
+        if (!state.free) {
+            if (void* block = Carve(state.slabs, size_class)) {
+                return block;
+            }
+            state.free = CollectRemote(state.slabs);
+        }
+        if (!state.free) {
+            state.slabs = NewSlab(state.slabs, size_class);
+            return Carve(state.slabs, size_class);
+        }
+        FreeNode* node = state.free;
+        state.free = node->next;
+        return node;
+    }
+
+    static void* Carve(Slab* slab, size_t size_class) {
+        if (!slab || reinterpret_cast<char*>(slab) + kSlabSize - slab->bump <
+                         static_cast<ptrdiff_t>(ClassSize(size_class))) {
+            return nullptr;
+        }
+        void* block = slab->bump;
+        slab->bump += ClassSize(size_class);
+        return block;
+    }
+
+    static FreeNode* CollectRemote(Slab* slabs) {
+        FreeNode* collected = nullptr;
+        for (Slab* slab = slabs; slab; slab = slab->next) {
+            FreeNode* list = slab->remote.exchange(nullptr, std::memory_order_acquire);
+            while (list) {
+                FreeNode* next = list->next;
+                list->next = collected;
+                collected = list;
+                list = next;
+            }
+        }
+        return collected;
+    }
+
+    Slab* NewSlab(Slab* next, size_t size_class) {
+        void* memory = ::operator new(kSlabSize, std::align_val_t{kSlabSize});
+        auto slab = new (memory) Slab{this, size_class, {nullptr}, next, nullptr};
+        slab->bump = reinterpret_cast<char*>(slab) + sizeof(Slab);
+        return slab;
+    }
+
+    ClassState classes_[kClasses];
+
+    inline static thread_local SlabHeap* current = nullptr;
+    inline static thread_local bool exiting = false;
+};
+
+// Stateless allocator over SlabHeap; blocks bigger than SlabHeap::kMaxSize or over-aligned ones
+// go to the global allocator.
+template <typename T>
+struct SlabAllocator {
+    using value_type = T;
+
+    SlabAllocator() = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>&) {
+    }
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(SlabHeap::Allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* ptr, size_t count) {
+        SlabHeap::Deallocate(ptr, count * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U>&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const SlabAllocator<U>&) const {
+        return false;
+    }
+};
+
+// MakeShared with the block taken from the calling thread's slab heap
+template <typename T, typename Policy = AtomicCounting, typename... Args>
+SharedPtr<T, Policy> MakeSharedOnSlab(Args&&... args) {
+    return AllocateShared<T, Policy>(SlabAllocator<T>(), std::forward<Args>(args)...);
+}
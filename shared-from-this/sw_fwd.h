@@ -1,13 +1,15 @@
 #pragma once
 
+#include "counting.h"
+
 #include <exception>
 
 class ESFTBase {};
 
 class BadWeakPtr : public std::exception {};
 
-template <typename T>
+template <typename T, typename Policy = AtomicCounting>
 class SharedPtr;
 
-template <typename T>
+template <typename T, typename Policy = AtomicCounting>
 class WeakPtr;
@@ -89,3 +89,136 @@ TEST_CASE("WeakFromThis") {
     REQUIRE(!weak.Expired());
     REQUIRE(weak.Lock().Get() == ptr);
 }
+
+TEST_CASE("SharedFromThis is set up by the first owner only") {
+    SECTION("Copies leave the weak count alone") {
+        auto sp = MakeShared<T>();
+        REQUIRE(sp.block_->cnt_weak == 1);
+        SharedPtr<T> copy = sp;
+        SharedPtr<T> moved = std::move(copy);
+        SharedPtr<T> aliased(moved, moved.Get());
+        WeakPtr<T> weak(sp);
+        SharedPtr<T> locked = weak.Lock();
+        SharedPtr<T> promoted(weak);
+        REQUIRE(sp.block_->cnt_weak == 2);
+        REQUIRE(sp->SharedFromThis() == sp);
+        REQUIRE(sp.UseCount() == 5);
+    }
+
+    SECTION("Empty pointers") {
+        SharedPtr<T> empty;
+        SharedPtr<T> copy = empty;
+        SharedPtr<Y> derived;
+        SharedPtr<T> converted = derived;
+        SharedPtr<T> moved = std::move(derived);
+        REQUIRE(!copy);
+        REQUIRE(!converted);
+        REQUIRE(!moved);
+    }
+
+    SECTION("Reset takes ownership") {
+        SharedPtr<T> sp;
+        T* ptr = new T;
+        sp.Reset(ptr);
+        REQUIRE(ptr->SharedFromThis() == sp);
+        REQUIRE(sp.block_->cnt_weak == 1);
+        SharedPtr<T> owned(new T);
+        REQUIRE(owned.block_->cnt_weak == 1);
+        Z* derived = new Z;
+        sp.Reset(derived);
+        REQUIRE(derived->SharedFromThis() == sp);
+    }
+}
+
+struct Node : EnableSharedFromThis<Node> {
+    ~Node() {
+        in_destructor_shared = SharedFromThis().Get() != nullptr;
+        in_destructor_expired = WeakFromThis().Expired();
+    }
+
+    inline static bool in_destructor_shared = true;
+    inline static bool in_destructor_expired = false;
+};
+
+TEST_CASE("Compact EnableSharedFromThis") {
+    SECTION("One pointer, and no weak reference") {
+        STATIC_REQUIRE(sizeof(EnableSharedFromThis<Node>) == sizeof(void*));
+        STATIC_REQUIRE(sizeof(Node) == sizeof(void*));
+        auto sp = MakeShared<Node>();
+        REQUIRE(sp.block_->cnt_weak == 1);
+        WeakPtr<Node> weak = sp->WeakFromThis();
+        REQUIRE(sp.block_->cnt_weak == 2);
+        REQUIRE(weak.Lock() == sp);
+    }
+
+    SECTION("SharedFromThis of a const object") {
+        auto sp = MakeShared<Node>();
+        const Node* node = sp.Get();
+        SharedPtr<const Node> shared = node->SharedFromThis();
+        REQUIRE(shared.Get() == node);
+        REQUIRE(sp.UseCount() == 2);
+        REQUIRE(node->WeakFromThis().Lock().Get() == node);
+    }
+
+    SECTION("Not owned yet") {
+        Node node;
+        REQUIRE(!node.SharedFromThis());
+        REQUIRE(node.WeakFromThis().Expired());
+        REQUIRE(!static_cast<const Node&>(node).SharedFromThis());
+    }
+
+    SECTION("Virtual base") {
+        STATIC_REQUIRE(!kStaticDowncast<const Foo, const EnableSharedFromThis<Foo>>);
+        SharedPtr<Foo> foo(new Bar(1));
+        const Foo* cfoo = foo.Get();
+        REQUIRE(cfoo->SharedFromThis().Get() == foo.Get());
+        REQUIRE(foo->WeakFromThis().Lock() == foo);
+
+        auto made = MakeShared<Bar>(2);
+        REQUIRE(made->SharedFromThis().Get() == static_cast<Foo*>(made.Get()));
+    }
+
+    SECTION("The object outlives its owners") {
+        static Node pooled;
+        auto keep = [](Node*) {};
+        {
+            SharedPtr<Node> owner(&pooled, keep);
+            REQUIRE(owner.block_->cnt_weak == 2);
+            REQUIRE(pooled.SharedFromThis() == owner);
+            SharedPtr<Node> other(&pooled, keep);
+            REQUIRE(pooled.SharedFromThis() == owner);
+        }
+        REQUIRE(!pooled.SharedFromThis());
+        REQUIRE(pooled.WeakFromThis().Expired());
+        SharedPtr<Node> again(&pooled, keep);
+        REQUIRE(pooled.SharedFromThis() == again);
+        REQUIRE(pooled.SharedFromThis().UseCount() == 2);
+    }
+
+    SECTION("Virtual base, outliving its owner") {
+        Bar bar(1);
+        {
+            SharedPtr<Foo> owner(&bar, [](Foo*) {});
+            REQUIRE(bar.SharedFromThis() == owner);
+        }
+        REQUIRE(!bar.SharedFromThis());
+        REQUIRE(bar.WeakFromThis().Expired());
+    }
+
+    SECTION("Copies have no owner") {
+        auto sp = MakeShared<Node>();
+        Node copy = *sp;
+        REQUIRE(!copy.SharedFromThis());
+        copy = *sp;
+        REQUIRE(!copy.SharedFromThis());
+        REQUIRE(sp->SharedFromThis() == sp);
+    }
+
+    SECTION("Expired inside the destructor") {
+        Node::in_destructor_shared = true;
+        Node::in_destructor_expired = false;
+        MakeShared<Node>().Reset();
+        REQUIRE(!Node::in_destructor_shared);
+        REQUIRE(Node::in_destructor_expired);
+    }
+}
@@ -0,0 +1,118 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+struct Arena {
+    alignas(std::max_align_t) char buffer[1024];
+    size_t used = 0;
+    int allocations = 0;
+    int deallocations = 0;
+};
+
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator(Arena* arena) : arena(arena) {
+    }
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {
+    }
+
+    T* allocate(size_t n) {
+        size_t offset = (arena->used + alignof(T) - 1) / alignof(T) * alignof(T);
+        arena->used = offset + n * sizeof(T);
+        ++arena->allocations;
+        return reinterpret_cast<T*>(arena->buffer + offset);
+    }
+    void deallocate(T*, size_t) {
+        ++arena->deallocations;
+    }
+
+    Arena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& left, const ArenaAllocator<U>& right) {
+    return left.arena == right.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& left, const ArenaAllocator<U>& right) {
+    return !(left == right);
+}
+
+template <typename T>
+struct StatelessAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = StatelessAllocator<U>;
+    };
+
+    StatelessAllocator() = default;
+    template <typename U>
+    StatelessAllocator(const StatelessAllocator<U>&) {
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("AllocateShared") {
+    SECTION("Empty allocator is free") {
+        static_assert(sizeof(BlockAllocated<int, StatelessAllocator<int>, AtomicCounting>) ==
+                      sizeof(BlockEmplace<int, AtomicCounting>));
+        static_assert(sizeof(BlockAllocated<int, ArenaAllocator<int>, AtomicCounting>) >
+                      sizeof(BlockEmplace<int, AtomicCounting>));
+    }
+
+    SECTION("One allocation with the default allocator") {
+        EXPECT_ONE_ALLOCATION(REQUIRE(*AllocateShared<int>(StatelessAllocator<int>(), 42) == 42));
+    }
+
+    SECTION("Everything goes through the arena") {
+        Arena arena;
+        {
+            SharedPtr<std::string> sp;
+            EXPECT_ZERO_ALLOCATIONS(sp = AllocateShared<std::string>(ArenaAllocator<char>(&arena), "arena"));
+            REQUIRE(*sp == "arena");
+            REQUIRE(arena.allocations == 1);
+
+            WeakPtr<std::string> weak = sp;
+            sp.Reset();
+            REQUIRE(weak.Expired());
+            REQUIRE(arena.deallocations == 0);
+        }
+        REQUIRE(arena.deallocations == 1);
+    }
+
+    SECTION("Lifetimes") {
+        Arena arena;
+        {
+            auto sp = AllocateShared<MyInt, NonAtomicCounting>(ArenaAllocator<MyInt>(&arena), 5);
+            auto copy = sp;
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+        REQUIRE(arena.deallocations == 1);
+    }
+
+    SECTION("Faulty constructor") {
+        struct Throwing {
+            Throwing() {
+                throw 42;
+            }
+        };
+        Arena arena;
+        REQUIRE_THROWS(AllocateShared<Throwing>(ArenaAllocator<Throwing>(&arena)));
+        REQUIRE(arena.deallocations == 1);
+    }
+}
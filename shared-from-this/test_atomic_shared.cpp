@@ -0,0 +1,104 @@
+#include "atomic_shared.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct Tracked {
+    Tracked(int) {
+        ++alive;
+    }
+    ~Tracked() {
+        --alive;
+    }
+    inline static std::atomic<int> alive = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("AtomicSharedPtr basics") {
+    static_assert(AtomicSharedPtr<int>::kIsAlwaysLockFree);
+
+    SECTION("Empty") {
+        AtomicSharedPtr<int> atomic;
+        REQUIRE(atomic.Load().Get() == nullptr);
+    }
+
+    SECTION("Load/Store/Exchange") {
+        {
+            AtomicSharedPtr<MyInt> atomic(MakeShared<MyInt>(1));
+            auto first = atomic.Load();
+            REQUIRE(*first == 1);
+            REQUIRE(first.UseCount() == 2);
+
+            atomic.Store(MakeShared<MyInt>(2));
+            REQUIRE(first.UseCount() == 1);
+            REQUIRE(*atomic.Load() == 2);
+
+            auto second = atomic.Exchange(SharedPtr<MyInt>());
+            REQUIRE(*second == 2);
+            REQUIRE(second.UseCount() == 1);
+            REQUIRE(atomic.Load().Get() == nullptr);
+            atomic.Store(first);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("CompareExchange") {
+        auto a = MakeShared<int>(1);
+        auto b = MakeShared<int>(2);
+        AtomicSharedPtr<int> atomic(a);
+
+        SharedPtr<int> expected = b;
+        REQUIRE(!atomic.CompareExchange(expected, b));
+        REQUIRE(expected == a);
+
+        REQUIRE(atomic.CompareExchange(expected, b));
+        REQUIRE(atomic.Load() == b);
+        REQUIRE(a.UseCount() == 2);
+        expected.Reset();
+        REQUIRE(a.UseCount() == 1);
+
+        SharedPtr<int> empty;
+        REQUIRE(!atomic.CompareExchange(empty, a));
+        REQUIRE(empty == b);
+    }
+}
+
+TEST_CASE("AtomicSharedPtr under contention") {
+    {
+        AtomicSharedPtr<Tracked> atomic(MakeShared<Tracked>(0));
+        std::atomic<bool> stop{false};
+        std::atomic<int> empty_loads{0};
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; ++i) {
+            readers.emplace_back([&] {
+                while (!stop.load()) {
+                    if (!atomic.Load()) {
+                        ++empty_loads;
+                    }
+                }
+            });
+        }
+        std::thread swapper([&] {
+            for (int i = 0; i < 1000; ++i) {
+                auto expected = atomic.Load();
+                atomic.CompareExchange(expected, MakeShared<Tracked>(i));
+            }
+        });
+        for (int i = 0; i < 1000; ++i) {
+            atomic.Store(MakeShared<Tracked>(i));
+        }
+        swapper.join();
+        stop = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        REQUIRE(empty_loads == 0);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
@@ -0,0 +1,106 @@
+#include "biased.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct Payload {
+    Payload(int value) : value(value) {
+        ++alive;
+    }
+    ~Payload() {
+        --alive;
+    }
+    int value;
+    inline static std::atomic<int> alive = 0;
+};
+
+using BiasedPtr = SharedPtr<Payload, BiasedCounting>;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Biased counting on the owner thread") {
+    {
+        auto sp = MakeShared<Payload, BiasedCounting>(1);
+        BiasedPtr copy = sp;
+        REQUIRE(sp.UseCount() == 2);
+        WeakPtr<Payload, BiasedCounting> weak = copy;
+        copy.Reset();
+        REQUIRE(sp.UseCount() == 1);
+        REQUIRE(weak.Lock()->value == 1);
+        sp.Reset();
+        REQUIRE(weak.Expired());
+    }
+    REQUIRE(Payload::alive == 0);
+}
+
+TEST_CASE("Biased counting across threads") {
+    SECTION("Last reference dropped by another thread") {
+        auto sp = MakeShared<Payload, BiasedCounting>(2);
+        std::thread([moved = std::move(sp)]() mutable {
+            BiasedPtr copy = moved;
+            REQUIRE(copy.UseCount() == 2);
+        }).join();
+        // The owner count is left behind; the next release on this thread merges the block.
+        auto other = MakeShared<Payload, BiasedCounting>(3);
+        other.Reset();
+        REQUIRE(Payload::alive == 0);
+    }
+
+    SECTION("Owner exits first") {
+        BiasedPtr survivor;
+        std::thread([&] {
+            auto sp = MakeShared<Payload, BiasedCounting>(4);
+            survivor = sp;
+        }).join();
+        REQUIRE(survivor.UseCount() == 1);
+        REQUIRE(survivor->value == 4);
+        survivor.Reset();
+        REQUIRE(Payload::alive == 0);
+    }
+
+    SECTION("Many threads") {
+        {
+            auto sp = MakeShared<Payload, BiasedCounting>(5);
+            std::vector<std::thread> threads;
+            for (int i = 0; i < 4; ++i) {
+                threads.emplace_back([sp] {
+                    for (int j = 0; j < 1000; ++j) {
+                        BiasedPtr copy = sp;
+                    }
+                });
+            }
+            for (int j = 0; j < 1000; ++j) {
+                BiasedPtr copy = sp;
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            REQUIRE(sp.UseCount() == 1);
+        }
+        REQUIRE(Payload::alive == 0);
+    }
+
+    SECTION("Lock on another thread races the owner's last release") {
+        for (int round = 0; round < 200; ++round) {
+            auto sp = MakeShared<Payload, BiasedCounting>(round);
+            WeakPtr<Payload, BiasedCounting> weak = sp;
+            std::atomic<bool> bad_value = false;
+            std::thread locker([weak, round, &bad_value] {
+                while (auto locked = weak.Lock()) {
+                    if (locked->value != round) {
+                        bad_value = true;
+                    }
+                }
+            });
+            sp.Reset();
+            locker.join();
+            REQUIRE(!bad_value);
+            REQUIRE(Payload::alive == 0);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include "shared.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Block pool") {
+    using IntBlock = Block<int, AtomicCounting>;
+
+    SECTION("Adopting a pointer reuses the freed block") {
+        { SharedPtr<int> warm(new int(0)); }
+        void* block = nullptr;
+        {
+            SharedPtr<int> sp(new int(1));
+            block = sp.block_;
+        }
+        SharedPtr<int> sp(new int(2));
+        REQUIRE(sp.block_ == block);
+    }
+
+    SECTION("Only the object is allocated once the pool is warm") {
+        { SharedPtr<int> warm(new int(0)); }
+        EXPECT_ONE_ALLOCATION(SharedPtr<int> sp(new int(1)));
+        SharedPtr<int> sp;
+        EXPECT_ONE_ALLOCATION(sp.Reset(new int(2)));
+        EXPECT_ONE_ALLOCATION(sp.Reset(new int(3)));
+    }
+
+    SECTION("Blocks of one size class are shared between types") {
+        static_assert(sizeof(Block<MyInt, AtomicCounting>) == sizeof(IntBlock));
+        { SharedPtr<int> warm(new int(0)); }
+        EXPECT_ONE_ALLOCATION(SharedPtr<MyInt> sp(new MyInt(1)));
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Cached blocks are bounded") {
+        std::vector<SharedPtr<int>> many;
+        for (size_t i = 0; i < 2 * BlockPool::kMaxCached; ++i) {
+            many.emplace_back(new int(i));
+        }
+        many.clear();
+        REQUIRE(BlockPool::CachedCount(sizeof(IntBlock)) == BlockPool::kMaxCached);
+    }
+
+    SECTION("Blocks freed on another thread go to its pool") {
+        SharedPtr<int> sp(new int(5));
+        size_t cached = 0;
+        std::thread([&sp, &cached] {
+            sp.Reset();
+            cached = BlockPool::CachedCount(sizeof(IntBlock));
+        }).join();
+        REQUIRE(cached == 1);
+    }
+
+    SECTION("Deleters") {
+        int released = 0;
+        auto deleter = [&released](int* ptr) {
+            ++released;
+            delete ptr;
+        };
+        { SharedPtr<int> warm(new int(0), deleter); }
+        EXPECT_ONE_ALLOCATION(SharedPtr<int> sp(new int(1), deleter));
+        REQUIRE(released == 2);
+    }
+}
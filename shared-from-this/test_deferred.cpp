@@ -0,0 +1,108 @@
+#include "deferred.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Node {
+    explicit Node(int value) : value(value) {
+        ++alive;
+    }
+    ~Node() {
+        destroyed_on = std::this_thread::get_id();
+        --alive;
+    }
+
+    int value;
+    SharedPtr<Node, DeferredCounting> next;
+    inline static std::atomic<int> alive = 0;
+    inline static std::thread::id destroyed_on;
+};
+
+using DeferredPtr = SharedPtr<Node, DeferredCounting>;
+
+// Flushes from its destructor, which runs on the reclaimer thread
+struct Flusher {
+    ~Flusher() {
+        Reclaimer::Flush();
+        flushed = true;
+    }
+
+    inline static std::atomic<bool> flushed = false;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Deferred destruction") {
+    SECTION("The last release hands the object to the reclaimer") {
+        auto sp = MakeShared<Node, DeferredCounting>(1);
+        WeakPtr<Node, DeferredCounting> weak(sp);
+        DeferredPtr copy = sp;
+        copy.Reset();
+        REQUIRE(sp.UseCount() == 1);
+        sp.Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(!weak.Lock());
+        Reclaimer::Flush();
+        REQUIRE(Node::alive == 0);
+        REQUIRE(Node::destroyed_on != std::this_thread::get_id());
+    }
+
+    SECTION("Adopted pointers") {
+        DeferredPtr sp(new Node(2));
+        sp.Reset();
+        Reclaimer::Flush();
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("A whole graph is torn down by the reclaimer") {
+        auto head = MakeShared<Node, DeferredCounting>(0);
+        Node* tail = head.Get();
+        for (int i = 1; i < 1000; ++i) {
+            tail->next = MakeShared<Node, DeferredCounting>(i);
+            tail = tail->next.Get();
+        }
+        REQUIRE(Node::alive == 1000);
+        head.Reset();
+        Reclaimer::Flush();
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Releases from many threads") {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([] {
+                for (int i = 0; i < 1000; ++i) {
+                    auto sp = MakeShared<Node, DeferredCounting>(i);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Reclaimer::Flush();
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Flush from the reclaimer thread does not wait for itself") {
+        MakeShared<Flusher, DeferredCounting>().Reset();
+        Reclaimer::Flush();
+        REQUIRE(Flusher::flushed);
+    }
+
+    SECTION("An idle reclaimer wakes up for a release") {
+        Reclaimer::Flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        MakeShared<Node, DeferredCounting>(1).Reset();
+        Reclaimer::Flush();
+        REQUIRE(Node::alive == 0);
+    }
+}
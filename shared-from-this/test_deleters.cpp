@@ -0,0 +1,89 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <common/my_int.h>
+
+#include <cstdlib>
+#include <vector>
+
+struct FreeDeleter {
+    void operator()(void* ptr) const {
+        std::free(ptr);
+    }
+};
+
+struct Pool {
+    int* Take() {
+        return &slots[taken++];
+    }
+
+    int slots[4] = {};
+    int taken = 0;
+    std::vector<int*> returned;
+};
+
+struct PoolDeleter {
+    void operator()(int* ptr) const {
+        pool->returned.push_back(ptr);
+    }
+    Pool* pool;
+};
+
+void DeleteMyInt(MyInt* ptr) {
+    delete ptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Custom deleters") {
+    SECTION("Stateless deleter is free") {
+        static_assert(sizeof(BlockDeleter<int, FreeDeleter, AtomicCounting>) ==
+                      sizeof(Block<int, AtomicCounting>));
+        static_assert(sizeof(BlockDeleter<int, PoolDeleter, AtomicCounting>) >
+                      sizeof(Block<int, AtomicCounting>));
+    }
+
+    SECTION("C handle") {
+        SharedPtr<int> sp(static_cast<int*>(std::malloc(sizeof(int))), FreeDeleter());
+        *sp = 42;
+        auto copy = sp;
+        REQUIRE(*copy == 42);
+    }
+
+    SECTION("Pooled objects") {
+        Pool pool;
+        WeakPtr<int> weak;
+        {
+            SharedPtr<int> sp(pool.Take(), PoolDeleter{&pool});
+            weak = sp;
+            sp.Reset(pool.Take(), PoolDeleter{&pool});
+            REQUIRE(pool.returned == std::vector<int*>{&pool.slots[0]});
+            REQUIRE(weak.Expired());
+        }
+        REQUIRE(pool.returned == std::vector<int*>{&pool.slots[0], &pool.slots[1]});
+    }
+
+    SECTION("Function pointer") {
+        {
+            SharedPtr<MyInt> sp(new MyInt(1), &DeleteMyInt);
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Lambda called once") {
+        int calls = 0;
+        {
+            SharedPtr<int> sp(new int(3), [&calls](int* ptr) {
+                ++calls;
+                delete ptr;
+            });
+            SharedPtr<int> copy = sp;
+            sp.Reset();
+            REQUIRE(calls == 0);
+        }
+        REQUIRE(calls == 1);
+    }
+}
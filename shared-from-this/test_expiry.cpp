@@ -0,0 +1,169 @@
+#include "expiry.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using ExpiringPtr = SharedPtr<int, ExpiryCounting<>>;
+using ExpiringWeak = WeakPtr<int, ExpiryCounting<>>;
+
+struct Counter : ExpiryListener<> {
+    Counter()
+        : ExpiryListener<>([](ExpiryListener<>* self) { ++static_cast<Counter*>(self)->calls; }) {
+    }
+
+    int calls = 0;
+};
+
+// An index of live objects by key that evicts each entry from its listener's callback
+struct Index {
+    struct Entry : ExpiryListener<> {
+        Entry(Index* index, int key)
+            : ExpiryListener<>([](ExpiryListener<>* self) {
+                  auto entry = static_cast<Entry*>(self);
+                  entry->index->entries.erase(entry->key);
+              }),
+              index(index),
+              key(key) {
+        }
+
+        Index* index;
+        int key;
+        ExpiringWeak value;
+    };
+
+    void Add(int key, const ExpiringPtr& value) {
+        auto [it, inserted] = entries.try_emplace(key, this, key);
+        it->second.value = value;
+        it->second.Listen(value);
+    }
+
+    std::unordered_map<int, Entry> entries;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Expiry listeners") {
+    SECTION("No cost for other policies") {
+        STATIC_REQUIRE(sizeof(BlockBase<AtomicCounting>) == 3 * sizeof(void*));
+        STATIC_REQUIRE(sizeof(BlockBase<ExpiryCounting<>>) == 4 * sizeof(void*));
+    }
+
+    SECTION("The callback runs once, when the object dies") {
+        auto sp = MakeShared<int, ExpiryCounting<>>(1);
+        Counter counter;
+        counter.Listen(sp);
+        ExpiringPtr copy = sp;
+        sp.Reset();
+        REQUIRE(counter.calls == 0);
+        copy.Reset();
+        REQUIRE(counter.calls == 1);
+        REQUIRE_FALSE(counter.Remove());
+        REQUIRE(counter.calls == 1);
+    }
+
+    SECTION("The object has expired when the callback runs") {
+        static ExpiringWeak* observed;
+        static bool expired;
+        ExpiryListener<> listener([](ExpiryListener<>*) {
+            expired = observed->Expired() && !observed->Lock();
+        });
+        auto sp = MakeShared<int, ExpiryCounting<>>(1);
+        ExpiringWeak weak(sp);
+        observed = &weak;
+        expired = false;
+        listener.Listen(sp);
+        sp.Reset();
+        REQUIRE(expired);
+    }
+
+    SECTION("Removed listeners are not called") {
+        auto sp = MakeShared<int, ExpiryCounting<>>(1);
+        Counter removed;
+        Counter kept;
+        removed.Listen(sp);
+        kept.Listen(sp);
+        REQUIRE(removed.Remove());
+        REQUIRE_FALSE(removed.Remove());
+        {
+            Counter destroyed;
+            destroyed.Listen(sp);
+        }
+        sp.Reset();
+        REQUIRE(removed.calls == 0);
+        REQUIRE(kept.calls == 1);
+    }
+
+    SECTION("Listening again moves the listener") {
+        auto first = MakeShared<int, ExpiryCounting<>>(1);
+        auto second = MakeShared<int, ExpiryCounting<>>(2);
+        Counter counter;
+        counter.Listen(first);
+        counter.Listen(second);
+        first.Reset();
+        REQUIRE(counter.calls == 0);
+        second.Reset();
+        REQUIRE(counter.calls == 1);
+    }
+
+    SECTION("Adopted pointers and non-atomic counts") {
+        SharedPtr<int, ExpiryCounting<>> adopted(new int(1));
+        Counter counter;
+        counter.Listen(adopted);
+        adopted.Reset();
+        REQUIRE(counter.calls == 1);
+
+        auto local = MakeShared<int, ExpiryCounting<NonAtomicCounting>>(1);
+        static int calls;
+        calls = 0;
+        ExpiryListener<NonAtomicCounting> listener([](ExpiryListener<NonAtomicCounting>*) {
+            ++calls;
+        });
+        listener.Listen(local);
+        local.Reset();
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("The callback may remove listeners of its block") {
+        auto sp = MakeShared<int, ExpiryCounting<>>(1);
+        Index index;
+        index.Add(1, sp);
+        index.Add(2, sp);
+        index.Add(3, MakeShared<int, ExpiryCounting<>>(3));
+        REQUIRE(index.entries.size() == 2);
+        auto other = MakeShared<int, ExpiryCounting<>>(4);
+        index.Add(4, other);
+        sp.Reset();
+        REQUIRE(index.entries.size() == 1);
+        REQUIRE(index.entries.count(4) == 1);
+        index.entries.clear();
+        other.Reset();
+    }
+
+    SECTION("Concurrent removes and last releases") {
+        constexpr size_t kRounds = 2000;
+        std::atomic<int> calls = 0;
+        static std::atomic<int>* counted;
+        counted = &calls;
+        std::atomic<int> removed = 0;
+        for (size_t round = 0; round < kRounds; ++round) {
+            auto sp = MakeShared<int, ExpiryCounting<>>(1);
+            ExpiryListener<> listener([](ExpiryListener<>*) { ++*counted; });
+            listener.Listen(sp);
+            std::thread releaser([sp = std::move(sp)]() mutable { sp.Reset(); });
+            if (listener.Remove()) {
+                ++removed;
+            }
+            releaser.join();
+        }
+        REQUIRE(calls + removed == static_cast<int>(kRounds));
+    }
+}
@@ -0,0 +1,161 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+struct IoBuffer {
+    static constexpr int kUntouched = 1;
+
+    IoBuffer() = default;
+    IoBuffer(int) {
+        ++explicit_constructions;
+    }
+
+    int header = kUntouched;
+    char data[1 << 16];
+
+    inline static int explicit_constructions = 0;
+};
+
+struct ThrowsThird {
+    ThrowsThird() {
+        if (++constructed == 3) {
+            throw 42;
+        }
+    }
+    ~ThrowsThird() {
+        ++destroyed;
+    }
+    inline static int constructed = 0;
+    inline static int destroyed = 0;
+};
+
+struct CachedPage {
+    CachedPage() = default;
+    CachedPage(int first) : data{first} {
+    }
+    ~CachedPage() {
+        ++destroyed;
+    }
+    int data[1024];
+
+    inline static int destroyed = 0;
+};
+
+template <>
+inline constexpr size_t kSeparatePayloadBytes<CachedPage> = 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeSharedForOverwrite") {
+    SECTION("One allocation") {
+        EXPECT_ONE_ALLOCATION(MakeSharedForOverwrite<IoBuffer>());
+    }
+
+    SECTION("Default-initialized") {
+        auto buffer = MakeSharedForOverwrite<IoBuffer>();
+        REQUIRE(buffer->header == IoBuffer::kUntouched);
+        REQUIRE(IoBuffer::explicit_constructions == 0);
+        buffer->data[0] = 'x';
+        REQUIRE(buffer.UseCount() == 1);
+    }
+
+    SECTION("Lifetimes") {
+        {
+            auto sp = MakeSharedForOverwrite<MyInt, NonAtomicCounting>();
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+template <typename P, typename = void>
+inline constexpr bool kIndexable = false;
+template <typename P>
+inline constexpr bool kIndexable<P, std::void_t<decltype(std::declval<P>()[0])>> = true;
+
+TEST_CASE("Arrays") {
+    SECTION("Only arrays are indexed") {
+        STATIC_REQUIRE(kIndexable<SharedPtr<int[]>>);
+        STATIC_REQUIRE(kIndexable<const SharedPtr<MyInt[]>&>);
+        STATIC_REQUIRE_FALSE(kIndexable<SharedPtr<int>>);
+        STATIC_REQUIRE_FALSE(kIndexable<SharedPtr<MyInt>>);
+    }
+
+    SECTION("Owning a new[] array") {
+        SharedPtr<MyInt[]> sp(new MyInt[3]);
+        REQUIRE(MyInt::AliveCount() == 3);
+        sp.Reset(new MyInt[2]);
+        REQUIRE(MyInt::AliveCount() == 2);
+        sp.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("MakeShared") {
+        auto values = MakeShared<double[]>(1000);
+        REQUIRE(reinterpret_cast<uintptr_t>(&values[0]) % 64 == 0);
+        // Elements follow the control block in the same allocation
+        auto block = reinterpret_cast<char*>(values.block_);
+        REQUIRE(reinterpret_cast<char*>(&values[0]) - block == 64);
+        for (int i = 0; i < 1000; ++i) {
+            REQUIRE(values[i] == 0);
+            values[i] = i;
+        }
+        SharedPtr<double[]> copy = values;
+        REQUIRE(copy[999] == 999);
+        REQUIRE(copy.UseCount() == 2);
+    }
+
+    SECTION("Lifetimes") {
+        {
+            auto sp = MakeShared<MyInt[]>(10);
+            REQUIRE(MyInt::AliveCount() == 10);
+            auto overwrite = MakeSharedForOverwrite<MyInt[], NonAtomicCounting>(5);
+            REQUIRE(MyInt::AliveCount() == 15);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Faulty constructor") {
+        REQUIRE_THROWS(MakeShared<ThrowsThird[]>(5));
+        REQUIRE(ThrowsThird::destroyed == 2);
+    }
+
+    SECTION("Size overflow") {
+        REQUIRE_THROWS_AS(MakeShared<double[]>(SIZE_MAX / sizeof(double)),
+                          std::bad_array_new_length);
+        REQUIRE_THROWS_AS(MakeSharedForOverwrite<MyInt[]>(SIZE_MAX), std::bad_array_new_length);
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+TEST_CASE("Separate payload") {
+    SECTION("Object outside the block") {
+        auto page = MakeShared<CachedPage>(7);
+        REQUIRE(page->data[0] == 7);
+        auto block = reinterpret_cast<char*>(page.block_);
+        auto object = reinterpret_cast<char*>(page.Get());
+        REQUIRE((object < block || object >= block + sizeof(Block<CachedPage, AtomicCounting>)));
+    }
+
+    SECTION("Freed while weak pointers remain") {
+        CachedPage::destroyed = 0;
+        auto page = MakeSharedForOverwrite<CachedPage>();
+        WeakPtr<CachedPage> weak = page;
+        page.Reset();
+        REQUIRE(CachedPage::destroyed == 1);
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Small types stay inline") {
+        EXPECT_ONE_ALLOCATION(MakeShared<int>(1));
+    }
+}
@@ -0,0 +1,141 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Non-atomic counting") {
+    SECTION("Copies and resets") {
+        auto sp = MakeShared<MyInt, NonAtomicCounting>(5);
+        SharedPtr<MyInt, NonAtomicCounting> copy = sp;
+        REQUIRE(sp.UseCount() == 2);
+        copy.Reset();
+        REQUIRE(sp.UseCount() == 1);
+        REQUIRE(*sp == 5);
+    }
+
+    SECTION("Weak pointers") {
+        WeakPtr<MyInt, NonAtomicCounting> weak;
+        {
+            SharedPtr<MyInt, NonAtomicCounting> sp(new MyInt(1));
+            weak = sp;
+            REQUIRE(!weak.Expired());
+            REQUIRE(weak.Lock().Get() == sp.Get());
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+        REQUIRE(weak.Expired());
+    }
+}
+
+TEST_CASE("No weak count") {
+    using Block = BlockEmplace<int, NoWeakCounting>;
+    static_assert(sizeof(Block) < sizeof(BlockEmplace<int, AtomicCounting>));
+
+    {
+        auto sp = MakeShared<MyInt, NoWeakCounting>(3);
+        auto copy = sp;
+        REQUIRE(copy.UseCount() == 2);
+        REQUIRE(MyInt::AliveCount() == 1);
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+}
+
+TEST_CASE("Atomic counting across threads") {
+    auto sp = MakeShared<MyInt>(7);
+    WeakPtr<MyInt> weak = sp;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([sp] {
+            for (int j = 0; j < 10000; ++j) {
+                auto copy = sp;
+                WeakPtr<MyInt> weak_copy = copy;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(sp.UseCount() == 1);
+    sp.Reset();
+    REQUIRE(weak.Expired());
+    REQUIRE(MyInt::AliveCount() == 0);
+}
+
+TEST_CASE("Packed counting") {
+    static_assert(sizeof(PackedCounting) == 8 && sizeof(PackedAtomicCounting) == 8);
+    static_assert(sizeof(BlockEmplace<int, PackedAtomicCounting>) <
+                  sizeof(BlockEmplace<int, AtomicCounting>));
+
+    SECTION("Counts stay in their halves") {
+        auto sp = MakeShared<MyInt, PackedCounting>(4);
+        WeakPtr<MyInt, PackedCounting> weak = sp;
+        WeakPtr<MyInt, PackedCounting> weak_copy = weak;
+        auto copy = weak.Lock();
+        REQUIRE(sp.UseCount() == 2);
+        REQUIRE(sp.block_->word == (2 | PackedLayout::kWeakOne * 3));
+        copy.Reset();
+        sp.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+        REQUIRE(weak.Expired());
+        REQUIRE(weak_copy.UseCount() == 0);
+    }
+
+    SECTION("Atomic across threads") {
+        auto sp = MakeShared<MyInt, PackedAtomicCounting>(7);
+        WeakPtr<MyInt, PackedAtomicCounting> weak = sp;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([sp] {
+                for (int j = 0; j < 10000; ++j) {
+                    auto copy = sp;
+                    WeakPtr<MyInt, PackedAtomicCounting> weak_copy = copy;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(sp.UseCount() == 1);
+        sp.Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+// Every Lock either fails or gets a live object, while the last strong reference is dropped
+template <typename Policy>
+void LockRacesLastRelease() {
+    for (int round = 0; round < 200; ++round) {
+        auto sp = MakeShared<MyInt, Policy>(round);
+        WeakPtr<MyInt, Policy> weak = sp;
+        std::atomic<bool> bad_value = false;
+        std::thread locker([weak, round, &bad_value] {
+            while (auto locked = weak.Lock()) {
+                if (!(*locked == round)) {
+                    bad_value = true;
+                }
+            }
+        });
+        sp.Reset();
+        locker.join();
+        REQUIRE(!bad_value);
+        REQUIRE(weak.Expired());
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+TEST_CASE("Lock races the last release") {
+    SECTION("Atomic") {
+        LockRacesLastRelease<AtomicCounting>();
+    }
+    SECTION("Packed atomic") {
+        LockRacesLastRelease<PackedAtomicCounting>();
+    }
+}
@@ -390,6 +390,19 @@ TEST_CASE("Aliasing constructor") {
         }
         REQUIRE(Data::data_was_deleted);
     }
+
+    SECTION("Moving in steals the reference") {
+        Data::data_was_deleted = false;
+        {
+            SharedPtr<Data> sp(new Data{42, 3.14});
+            double* y = &sp->y;
+            SharedPtr<double> sp2(std::move(sp), y);
+            REQUIRE(!sp);
+            REQUIRE(sp2.UseCount() == 1);
+            REQUIRE(*sp2 == 3.14);
+        }
+        REQUIRE(Data::data_was_deleted);
+    }
 }
 
 class Base {
@@ -431,6 +444,59 @@ TEST_CASE("Type conversions") {
     }
 }
 
+TEST_CASE("Pointer casts") {
+    SECTION("Copies") {
+        SharedPtr<Base> base(new Derived);
+        SharedPtr<Derived> derived = StaticPointerCast<Derived>(base);
+        REQUIRE(derived.Get() == base.Get());
+        REQUIRE(base.UseCount() == 2);
+
+        SharedPtr<Derived> dynamic = DynamicPointerCast<Derived>(base);
+        REQUIRE(dynamic.Get() == base.Get());
+        REQUIRE(base.UseCount() == 3);
+        REQUIRE(!DynamicPointerCast<Derived>(SharedPtr<Base>(new Base)));
+
+        SharedPtr<const int> constant(new int(1));
+        SharedPtr<int> mutable_int = ConstPointerCast<int>(constant);
+        *mutable_int = 2;
+        REQUIRE(*constant == 2);
+        REQUIRE(constant.UseCount() == 2);
+    }
+
+    SECTION("Moves steal the reference") {
+        Derived::i_was_deleted = false;
+        {
+            SharedPtr<Base> base(new Derived);
+            Base* raw = base.Get();
+            SharedPtr<Derived> derived = StaticPointerCast<Derived>(std::move(base));
+            REQUIRE(!base);
+            REQUIRE(derived.Get() == raw);
+            REQUIRE(derived.UseCount() == 1);
+
+            SharedPtr<Base> back = derived;
+            SharedPtr<Derived> dynamic = DynamicPointerCast<Derived>(std::move(back));
+            REQUIRE(!back);
+            REQUIRE(derived.UseCount() == 2);
+
+            SharedPtr<Base> other(new Base);
+            REQUIRE(!DynamicPointerCast<Derived>(std::move(other)));
+            REQUIRE(other.UseCount() == 1);
+
+            SharedPtr<const Derived> constant = std::move(dynamic);
+            SharedPtr<Derived> mutable_derived = ConstPointerCast<Derived>(std::move(constant));
+            REQUIRE(!constant);
+            REQUIRE(derived.UseCount() == 2);
+        }
+        REQUIRE(Derived::i_was_deleted);
+    }
+
+    SECTION("Empty") {
+        SharedPtr<Base> empty;
+        REQUIRE(!StaticPointerCast<Derived>(empty));
+        REQUIRE(!DynamicPointerCast<Derived>(std::move(empty)));
+    }
+}
+
 struct A {
     ~A() = default;
 };
@@ -467,3 +533,17 @@ TEST_CASE("Destructor for correct type") {
         REQUIRE(B::destructor_called);
     }
 }
+
+TEST_CASE("Observers follow the stored pointer") {
+    auto owner = MakeShared<int>(5);
+    SharedPtr<int> empty_alias(owner, nullptr);
+    REQUIRE(empty_alias.UseCount() == 2);
+    REQUIRE(!empty_alias);
+    REQUIRE(empty_alias.Get() == nullptr);
+
+    int outside = 7;
+    SharedPtr<int> alias(owner, &outside);
+    owner.Reset();
+    REQUIRE(alias);
+    REQUIRE(*alias == 7);
+}
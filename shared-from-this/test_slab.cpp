@@ -0,0 +1,80 @@
+#include "slab.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Slab MakeShared") {
+    SECTION("Lifetime") {
+        {
+            auto sp = MakeSharedOnSlab<MyInt>(7);
+            REQUIRE(*sp == 7);
+            REQUIRE(MyInt::AliveCount() == 1);
+            WeakPtr<MyInt> wp(sp);
+            sp.Reset();
+            REQUIRE(MyInt::AliveCount() == 0);
+            REQUIRE(wp.Expired());
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("The freed block is reused") {
+        void* block = nullptr;
+        {
+            auto sp = MakeSharedOnSlab<int>(1);
+            block = sp.block_;
+        }
+        auto sp = MakeSharedOnSlab<int>(2);
+        REQUIRE(sp.block_ == block);
+    }
+
+    SECTION("No global allocations once the slab is carved") {
+        { auto warm = MakeSharedOnSlab<int>(0); }
+        EXPECT_ZERO_ALLOCATIONS(auto sp = MakeSharedOnSlab<int>(1));
+    }
+
+    SECTION("Blocks freed on another thread go back to their home slab") {
+        std::vector<SharedPtr<int>> many;
+        for (int i = 0; i < 100; ++i) {
+            many.push_back(MakeSharedOnSlab<int>(i));
+        }
+        std::vector<void*> blocks;
+        for (auto& sp : many) {
+            blocks.push_back(sp.block_);
+        }
+        std::thread([&many] { many.clear(); }).join();
+
+        // Reused once this thread runs out of fresh blocks in its slab
+        std::vector<SharedPtr<int>> again;
+        bool reused = false;
+        for (size_t i = 0; i < SlabHeap::kSlabSize / SlabHeap::kGranularity && !reused; ++i) {
+            again.push_back(MakeSharedOnSlab<int>(0));
+            reused = std::find(blocks.begin(), blocks.end(), again.back().block_) != blocks.end();
+        }
+        REQUIRE(reused);
+    }
+
+    SECTION("Blocks outlive the thread that made them") {
+        SharedPtr<MyInt> sp;
+        std::thread([&sp] { sp = MakeSharedOnSlab<MyInt>(3); }).join();
+        REQUIRE(*sp == 3);
+        sp.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Big objects go to the global allocator") {
+        struct Big {
+            char data[512];
+        };
+        EXPECT_ONE_ALLOCATION(auto sp = MakeSharedOnSlab<Big>());
+    }
+}
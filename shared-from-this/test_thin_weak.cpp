@@ -0,0 +1,80 @@
+#include "thin_weak.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <common/my_int.h>
+
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ThinWeakPtr") {
+    static_assert(sizeof(ThinWeakPtr<int>) == sizeof(void*));
+    static_assert(sizeof(WeakPtr<int>) == 2 * sizeof(void*));
+
+    SECTION("Empty") {
+        ThinWeakPtr<int> empty;
+        REQUIRE(empty.Expired());
+        REQUIRE(!empty.Lock());
+        ThinWeakPtr<int> from_empty = SharedPtr<int>();
+        REQUIRE(from_empty.UseCount() == 0);
+    }
+
+    SECTION("Lock and Expired like WeakPtr") {
+        auto sp = MakeShared<MyInt>(5);
+        ThinWeakPtr<MyInt> thin = sp;
+        WeakPtr<MyInt> weak = sp;
+        REQUIRE(thin.UseCount() == 1);
+        {
+            auto locked = thin.Lock();
+            REQUIRE(locked.Get() == sp.Get());
+            REQUIRE(*locked == 5);
+            REQUIRE(thin.UseCount() == 2);
+        }
+        ThinWeakPtr<MyInt> copy = thin;
+        ThinWeakPtr<MyInt> moved = std::move(copy);
+        REQUIRE(copy.Expired());
+        sp.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+        REQUIRE(thin.Expired() == weak.Expired());
+        REQUIRE(moved.Expired());
+        REQUIRE(!moved.Lock());
+    }
+
+    SECTION("Every kind of block") {
+        std::string text = "looooooooooooooooooooooooooooooooooong";
+        auto made = MakeShared<std::string>(text);
+        SharedPtr<std::string> adopted(new std::string(text));
+        SharedPtr<std::string> deleted(new std::string(text),
+                                       [](std::string* ptr) { delete ptr; });
+        SharedPtr<std::string> allocated =
+            AllocateShared<std::string>(std::allocator<std::string>(), text);
+        for (auto* sp : {&made, &adopted, &deleted, &allocated}) {
+            ThinWeakPtr<std::string> thin = *sp;
+            REQUIRE(thin.Lock().Get() == sp->Get());
+            REQUIRE(*thin.Lock() == text);
+        }
+    }
+
+    SECTION("Aliased pointers are refused") {
+        struct Pair {
+            int first;
+            int second;
+        };
+        auto pair = MakeShared<Pair>(Pair{1, 2});
+        SharedPtr<int> first(pair, &pair->first);
+        SharedPtr<int> second(pair, &pair->second);
+        REQUIRE(ThinWeakPtr<int>::CanObserve(first));
+        REQUIRE(!ThinWeakPtr<int>::CanObserve(second));
+        REQUIRE_THROWS_AS(ThinWeakPtr<int>(second), std::invalid_argument);
+    }
+
+    SECTION("No allocations") {
+        auto sp = MakeShared<int>(1);
+        EXPECT_ZERO_ALLOCATIONS(ThinWeakPtr<int> thin(sp); REQUIRE(*thin.Lock() == 1));
+    }
+}
@@ -5,6 +5,9 @@
 
 #include <catch.hpp>
 
+#include <set>
+#include <unordered_set>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TEST_CASE("Empty weak") {
@@ -163,3 +166,67 @@ TEST_CASE("Lifetimes") {
         delete wp;
     }
 }
+
+TEST_CASE("Owner-based ordering and hashing") {
+    struct Pair {
+        int first;
+        int second;
+    };
+
+    SECTION("Aliases share an owner") {
+        auto pair = MakeShared<Pair>(Pair{1, 2});
+        SharedPtr<int> first(pair, &pair->first);
+        WeakPtr<int> second = SharedPtr<int>(pair, &pair->second);
+        auto other = MakeShared<Pair>(Pair{3, 4});
+
+        REQUIRE(!first.OwnerBefore(second));
+        REQUIRE(!second.OwnerBefore(first));
+        REQUIRE(OwnerEqual()(first, second));
+        REQUIRE(OwnerHash()(first) == OwnerHash()(second));
+        REQUIRE(pair.OwnerBefore(other) != other.OwnerBefore(pair));
+        REQUIRE(!OwnerEqual()(pair, other));
+    }
+
+    SECTION("Expired weak pointers keep their keys") {
+        std::set<WeakPtr<MyInt>, OwnerLess> ordered;
+        std::unordered_set<WeakPtr<MyInt>, OwnerHash, OwnerEqual> hashed;
+        auto kept = MakeShared<MyInt>(1);
+        auto dropped = MakeShared<MyInt>(2);
+        for (auto* ptr : {&kept, &dropped}) {
+            ordered.insert(*ptr);
+            hashed.insert(*ptr);
+        }
+        WeakPtr<MyInt> expired = dropped;
+        dropped.Reset();
+        REQUIRE(expired.Expired());
+
+        REQUIRE(ordered.count(expired) == 1);
+        REQUIRE(hashed.count(expired) == 1);
+        REQUIRE(ordered.find(kept) != ordered.end());
+        ordered.erase(expired);
+        hashed.erase(expired);
+        REQUIRE(ordered.size() == 1);
+        REQUIRE(hashed.size() == 1);
+        REQUIRE(kept.UseCount() == 1);
+    }
+
+    SECTION("SharedPtr in unordered containers") {
+        std::unordered_set<SharedPtr<int>> set;
+        auto one = MakeShared<int>(1);
+        set.insert(one);
+        set.insert(one);
+        set.insert(MakeShared<int>(1));
+        REQUIRE(set.size() == 2);
+        REQUIRE(set.count(one) == 1);
+        REQUIRE(std::hash<SharedPtr<int>>()(one) == HashPointer(one.block_));
+    }
+
+    SECTION("Pointer hash spreads aligned addresses") {
+        std::unordered_set<size_t> low_bits;
+        alignas(64) static char storage[64 * 64];
+        for (size_t i = 0; i < 64; ++i) {
+            low_bits.insert(HashPointer(storage + 64 * i) & 63);
+        }
+        REQUIRE(low_bits.size() > 16);
+    }
+}
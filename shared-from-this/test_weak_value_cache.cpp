@@ -0,0 +1,154 @@
+#include "weak_value_cache.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Asset {
+    explicit Asset(int id) : id(id) {
+        ++decoded;
+        ++alive;
+    }
+    ~Asset() {
+        --alive;
+    }
+
+    int id;
+    inline static std::atomic<int> decoded = 0;
+    inline static std::atomic<int> alive = 0;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("WeakValueCache") {
+    Asset::decoded = 0;
+
+    SECTION("Hits share the value") {
+        WeakValueCache<int, Asset> cache;
+        auto first = cache.GetOrCreate(1, 1);
+        auto second = cache.GetOrCreate(1, 1);
+        REQUIRE(first.Get() == second.Get());
+        REQUIRE(first.UseCount() == 2);
+        REQUIRE(Asset::decoded == 1);
+        REQUIRE(cache.Find(1).Get() == first.Get());
+        REQUIRE(!cache.Find(2));
+    }
+
+    SECTION("Values live only as long as their users") {
+        WeakValueCache<int, Asset> cache;
+        cache.GetOrCreate(1, 1);
+        REQUIRE(Asset::alive == 0);
+        REQUIRE(!cache.Find(1));
+        auto rebuilt = cache.GetOrCreate(1, 1);
+        REQUIRE(Asset::decoded == 2);
+    }
+
+    SECTION("Expired entries are purged as misses go by") {
+        WeakValueCache<int, Asset, AtomicCounting, std::hash<int>, 1> cache;
+        for (int i = 0; i < 1000; ++i) {
+            cache.GetOrCreate(i, i);
+        }
+        REQUIRE(cache.Size() < 1000);
+        auto kept = cache.GetOrCreate(-1, -1);
+        for (int i = 1000; i < 100000 && cache.Size() > 1; ++i) {
+            cache.GetOrCreate(i, i);
+        }
+        REQUIRE(cache.Find(-1).Get() == kept.Get());
+        REQUIRE(cache.Size() <= 2);
+    }
+
+    SECTION("A failed build leaves no entry behind") {
+        WeakValueCache<std::string, Asset> cache;
+        REQUIRE_THROWS_AS(cache.GetOrBuild("broken",
+                                           []() -> SharedPtr<Asset> {
+                                               throw std::runtime_error("decode");
+                                           }),
+                          std::runtime_error);
+        REQUIRE(cache.Size() == 0);
+        REQUIRE(cache.GetOrCreate("broken", 3)->id == 3);
+    }
+
+    SECTION("Concurrent requests build once") {
+        WeakValueCache<int, Asset> cache;
+        std::atomic<int> builds = 0;
+        std::vector<SharedPtr<Asset>> results(8);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < results.size(); ++t) {
+            threads.emplace_back([&, t] {
+                results[t] = cache.GetOrBuild(7, [&] {
+                    ++builds;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    return MakeShared<Asset>(7);
+                });
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(builds == 1);
+        for (auto& result : results) {
+            REQUIRE(result.Get() == results[0].Get());
+        }
+    }
+
+    SECTION("A waiter outlives a failed build followed by a new one") {
+        WeakValueCache<int, Asset> cache;
+        for (int round = 0; round < 20; ++round) {
+            SharedPtr<Asset> rebuilt;
+            std::thread builder([&] {
+                try {
+                    cache.GetOrBuild(round, [&]() -> SharedPtr<Asset> {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                        throw std::runtime_error("decode");
+                    });
+                } catch (const std::runtime_error&) {
+                }
+                // Straight back in, most likely ahead of the waiter woken by the failure
+                rebuilt = cache.GetOrBuild(round, [&] {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    return MakeShared<Asset>(round);
+                });
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            auto waited = cache.GetOrCreate(round, round);
+            builder.join();
+            REQUIRE(waited->id == round);
+            REQUIRE(waited.Get() == rebuilt.Get());
+        }
+    }
+
+    SECTION("Many keys from many threads") {
+        WeakValueCache<int, Asset> cache;
+        std::vector<std::thread> threads;
+        std::atomic<bool> mismatch = false;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                std::vector<SharedPtr<Asset>> held;
+                for (int i = 0; i < 2000; ++i) {
+                    int key = (i * 31 + t) % 500;
+                    auto value = cache.GetOrCreate(key, key);
+                    if (value->id != key) {
+                        mismatch = true;
+                    }
+                    if (i % 3 == 0) {
+                        held.push_back(value);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(!mismatch);
+    }
+    REQUIRE(Asset::alive == 0);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "shared.h"
+
+#include <stdexcept>
+#include <utility>
+
+// Weak pointer that stores the control block only, half the size of WeakPtr. Lock() gets the
+// object pointer back from the block, so it can only observe SharedPtrs that point to the object
+// their block owns: not aliased, and not converted to a base class at another address. Lock and
+// Expired behave as WeakPtr's.
+template <typename T, typename Policy = AtomicCounting>
+class ThinWeakPtr {
+public:
+    using Element = std::remove_extent_t<T>;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ThinWeakPtr() {
+    }
+
+    // Throws std::invalid_argument if `other` cannot be observed, see CanObserve
+    ThinWeakPtr(const SharedPtr<T, Policy>& other) {
+        if (!CanObserve(other)) {
+            throw std::invalid_argument("ThinWeakPtr of an aliased SharedPtr");
+        }
+        block_ = other.block_;
+        if (block_) {
+            PTR_STATS(WeakPtr, T, Construct);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
+        }
+    }
+
+    ThinWeakPtr(const ThinWeakPtr& other) {
+        block_ = other.block_;
+        if (block_) {
+            PTR_STATS(WeakPtr, T, Copy);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
+        }
+    }
+
+    ThinWeakPtr(ThinWeakPtr&& other) {
+        block_ = other.block_;
+        PTR_STATS_IF(block_, WeakPtr, T, Move);
+        other.block_ = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ThinWeakPtr& operator=(const ThinWeakPtr& other) {
+        ThinWeakPtr(other).Swap(*this);
+        return *this;
+    }
+    ThinWeakPtr& operator=(ThinWeakPtr&& other) {
+        ThinWeakPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+    ThinWeakPtr& operator=(const SharedPtr<T, Policy>& other) {
+        ThinWeakPtr(other).Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~ThinWeakPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        auto prev = block_;
+        block_ = nullptr;
+        if (prev) {
+            PTR_STATS(WeakPtr, T, Destroy);
+            PTR_STATS(WeakPtr, T, DecRef);
+            prev->DecWeakRef();
+        }
+    }
+    void Swap(ThinWeakPtr& other) {
+        std::swap(block_, other.block_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Whether `ptr` points to the object its block owns, at the same address
+    static bool CanObserve(const SharedPtr<T, Policy>& ptr) {
+        return !ptr.block_ || static_cast<const void*>(ptr.Get()) == ptr.block_->Object();
+    }
+
+    size_t UseCount() const {
+        if (!block_) {
+            return 0;
+        }
+        return block_->UseCount();
+    }
+    bool Expired() const {
+        return UseCount() == 0;
+    }
+    SharedPtr<T, Policy> Lock() const {
+        if (!block_) {
+            return SharedPtr<T, Policy>();
+        }
+        return SharedPtr<T, Policy>(block_, static_cast<Element*>(block_->Object()), true);
+    }
+
+    BlockBase<Policy>* block_ = nullptr;
+};
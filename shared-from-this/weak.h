@@ -4,7 +4,7 @@
 #include "shared.h"
 
 // https://en.cppreference.com/w/cpp/memory/weak_ptr
-template <typename T>
+template <typename T, typename Policy>
 class WeakPtr {
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -18,17 +18,21 @@ public:
             block_ = other.block_;
             ptr_ = other.ptr_;
             if (block_) {
-                ++block_->cnt_weak;
+                PTR_STATS(WeakPtr, T, Copy);
+                PTR_STATS(WeakPtr, T, IncRef);
+                block_->IncWeakRef();
             }
         }
     }
 
     template <class Y>
-    WeakPtr(const WeakPtr<Y>& other) {
+    WeakPtr(const WeakPtr<Y, Policy>& other) {
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt_weak;
+            PTR_STATS(WeakPtr, T, Copy);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
         }
     }
 
@@ -36,38 +40,56 @@ public:
         if (this != &other) {
             block_ = other.block_;
             ptr_ = other.ptr_;
+            PTR_STATS_IF(block_, WeakPtr, T, Move);
             other.block_ = nullptr;
             other.ptr_ = nullptr;
         }
     }
 
+    // A new weak reference to `ptr`, owned by `block`
+    WeakPtr(BlockBase<Policy>* block, std::remove_extent_t<T>* ptr) {
+        block_ = block;
+        ptr_ = ptr;
+        if (block_) {
+            PTR_STATS(WeakPtr, T, Construct);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
+        }
+    }
+
     // Demote `SharedPtr`
     // #2 from https://en.cppreference.com/w/cpp/memory/weak_ptr/weak_ptr
-    WeakPtr(const SharedPtr<T>& other) {
+    WeakPtr(const SharedPtr<T, Policy>& other) {
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt_weak;
+            PTR_STATS(WeakPtr, T, Construct);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
         }
     }
 
-    WeakPtr& operator=(const SharedPtr<T>& other) {
+    WeakPtr& operator=(const SharedPtr<T, Policy>& other) {
         Reset();
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt_weak;
+            PTR_STATS(WeakPtr, T, Construct);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
         }
         return *this;
     }
 
     template <class Y>
-    WeakPtr& operator=(const SharedPtr<Y>& other) {
+    WeakPtr& operator=(const SharedPtr<Y, Policy>& other) {
         Reset();
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt_weak;
+            PTR_STATS(WeakPtr, T, Construct);
+            PTR_STATS(WeakPtr, T, IncRef);
+            block_->IncWeakRef();
         }
         return *this;
     }
@@ -81,7 +103,9 @@ public:
             block_ = other.block_;
             ptr_ = other.ptr_;
             if (block_) {
-                ++block_->cnt_weak;
+                PTR_STATS(WeakPtr, T, Copy);
+                PTR_STATS(WeakPtr, T, IncRef);
+                block_->IncWeakRef();
             }
         }
         return *this;
@@ -91,6 +115,7 @@ public:
             Reset();
             block_ = other.block_;
             ptr_ = other.ptr_;
+            PTR_STATS_IF(block_, WeakPtr, T, Move);
             other.block_ = nullptr;
             other.ptr_ = nullptr;
         }
@@ -108,14 +133,14 @@ public:
     // Modifiers
 
     void Reset() {
-        if (block_) {
-            --block_->cnt_weak;
-            if (block_->cnt_weak == 0 && block_->cnt == 0) {
-                delete block_;
-            }
-        }
+        auto prev = block_;
         block_ = nullptr;
         ptr_ = nullptr;
+        if (prev) {
+            PTR_STATS(WeakPtr, T, Destroy);
+            PTR_STATS(WeakPtr, T, DecRef);
+            prev->DecWeakRef();
+        }
     }
     void Swap(WeakPtr& other) {
         std::swap(block_, other.block_);
@@ -129,7 +154,7 @@ public:
         if (!block_) {
             return 0;
         }
-        return block_->cnt;
+        return block_->UseCount();
     }
     bool Expired() const {
         if (ptr_ == nullptr) {
@@ -138,17 +163,59 @@ public:
         if (block_ == nullptr) {
             return true;
         }
-        if (block_->cnt == 0) {
+        if (block_->UseCount() == 0) {
             return true;
         }
         return false;
     }
-    SharedPtr<T> Lock() const {
+    SharedPtr<T, Policy> Lock() const {
         if (block_) {
-            return SharedPtr<T>(block_, ptr_, true);
+            return SharedPtr<T, Policy>(block_, ptr_, true);
         }
-        return SharedPtr<T>(nullptr);
+        return SharedPtr<T, Policy>(nullptr);
+    }
+
+    // Order by control block, as std::weak_ptr::owner_before. Stays valid after expiration, so
+    // expired pointers keep their place in ordered containers.
+    template <typename Y>
+    bool OwnerBefore(const WeakPtr<Y, Policy>& other) const {
+        return std::less<BlockBase<Policy>*>()(block_, other.block_);
+    }
+    template <typename Y>
+    bool OwnerBefore(const SharedPtr<Y, Policy>& other) const {
+        return std::less<BlockBase<Policy>*>()(block_, other.block_);
+    }
+
+    BlockBase<Policy>* block_ = nullptr;
+    std::remove_extent_t<T>* ptr_ = nullptr;
+};
+
+// Owner-based functors for keying containers by object identity with SharedPtr and WeakPtr
+// alike, mixed freely: none of them locks or promotes a WeakPtr, or touches a counter.
+// Transparent, so a table of WeakPtrs can be searched with a SharedPtr.
+struct OwnerLess {
+    using is_transparent = void;
+
+    template <typename A, typename B>
+    bool operator()(const A& left, const B& right) const {
+        return left.OwnerBefore(right);
+    }
+};
+
+struct OwnerEqual {
+    using is_transparent = void;
+
+    template <typename A, typename B>
+    bool operator()(const A& left, const B& right) const {
+        return left.block_ == right.block_;
+    }
+};
+
+struct OwnerHash {
+    using is_transparent = void;
+
+    template <typename Ptr>
+    size_t operator()(const Ptr& ptr) const {
+        return HashPointer(ptr.block_);
     }
-    BlockBase* block_ = nullptr;
-    T* ptr_ = nullptr;
 };
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "shared.h"
+#include "weak.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Concurrent identity cache: maps keys to WeakPtrs, so a value lives exactly as long as someone
+// outside the cache holds it, and concurrent requests for one key share one value.
+//
+// The keys are split over kShards independently locked shards. A miss builds the value outside
+// the lock; other requests for the same key wait for that build rather than starting their own,
+// and if it throws, one of them builds instead. Entries whose value has expired are purged a few
+// buckets at a time, on every miss, so there is never a scan of the whole table.
+template <typename K, typename V, typename Policy = AtomicCounting, typename Hash = std::hash<K>,
+          size_t kShards = 16>
+class WeakValueCache {
+    static_assert(Policy::kHasWeak, "the cache holds WeakPtrs");
+    static_assert(kShards > 0 && (kShards & (kShards - 1)) == 0, "kShards is a power of two");
+
+public:
+    // Buckets of a shard checked for expired entries on every miss
+    static constexpr size_t kPurgeBuckets = 2;
+
+    explicit WeakValueCache(Hash hash = Hash()) : hash_(std::move(hash)) {
+    }
+
+    // The live value for `key`, or an empty pointer
+    SharedPtr<V, Policy> Find(const K& key) {
+        Shard& shard = ShardOf(key);
+        std::lock_guard guard(shard.lock);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end() || it->second.building) {
+            return SharedPtr<V, Policy>();
+        }
+        return it->second.value.Lock();
+    }
+
+    // The live value for `key`, or the one `build()` returns, which the cache then remembers.
+    // `build` returns SharedPtr<V, Policy> and runs at most once per miss, without the lock held.
+    template <typename Builder>
+    SharedPtr<V, Policy> GetOrBuild(const K& key, Builder&& build) {
+        Shard& shard = ShardOf(key);
+        std::unique_lock guard(shard.lock);
+        while (true) {
+            Entry& entry = shard.map[key];
+            if (!entry.building) {
+                if (auto value = entry.value.Lock()) {
+                    return value;
+                }
+                entry.building = true;
+                shard.Purge();
+                return BuildEntry(shard, guard, key, build);
+            }
+            // An entry with waiters is never erased, so the reference stays valid and the wait
+            // is for the builds of this very entry
+            ++entry.waiters;
+            shard.built.wait(guard, [&] { return !entry.building; });
+            SharedPtr<V, Policy> value = entry.handoff;
+            if (--entry.waiters == 0) {
+                entry.handoff.Reset();
+            }
+            if (value) {
+                return value;
+            }
+            // The build threw: go round, and build unless another waiter already is
+        }
+    }
+
+    // GetOrBuild with MakeShared<V, Policy>(args...)
+    template <typename... Args>
+    SharedPtr<V, Policy> GetOrCreate(const K& key, Args&&... args) {
+        return GetOrBuild(key, [&] { return MakeShared<V, Policy>(std::forward<Args>(args)...); });
+    }
+
+    // Entries, counting expired ones not purged yet
+    size_t Size() const {
+        size_t size = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard guard(shard.lock);
+            size += shard.map.size();
+        }
+        return size;
+    }
+
+private:
+    struct Entry {
+        WeakPtr<V, Policy> value;
+        bool building = false;
+        size_t waiters = 0;
+        // Keeps a fresh value alive until every waiter has picked it up
+        SharedPtr<V, Policy> handoff;
+    };
+
+    using Map = std::unordered_map<K, Entry, Hash>;
+
+    struct alignas(64) Shard {
+        // Checks the next kPurgeBuckets buckets, going round the table across calls
+        void Purge() {
+            size_t buckets = map.bucket_count();
+            std::vector<typename Map::iterator> expired;
+            for (size_t step = 0; step < kPurgeBuckets; ++step) {
+                size_t bucket = purge_cursor++ % buckets;
+                for (auto it = map.begin(bucket); it != map.end(bucket); ++it) {
+                    if (!it->second.building && it->second.waiters == 0 &&
+                        it->second.value.Expired()) {
+                        expired.push_back(map.find(it->first));
+                    }
+                }
+            }
+            // Erasing a node leaves the iterators to the others valid
+            for (auto it : expired) {
+                map.erase(it);
+            }
+        }
+
+        mutable std::mutex lock;
+        std::condition_variable built;
+        Map map;
+        size_t purge_cursor = 0;
+    };
+
+    Shard& ShardOf(const K& key) {
+        // The map hashes by the low bits: pick the shard with the high ones
+        uint64_t mixed = static_cast<uint64_t>(hash_(key)) * 0x9e3779b97f4a7c15ULL;
+        return shards_[(mixed >> 32) & (kShards - 1)];
+    }
+
+    template <typename Builder>
+    static SharedPtr<V, Policy> BuildEntry(Shard& shard, std::unique_lock<std::mutex>& guard,
+                                           const K& key, Builder& build) {
+        SharedPtr<V, Policy> value;
+        guard.unlock();
+        try {
+            value = build();
+        } catch (...) {
+            guard.lock();
+            auto failed = shard.map.find(key);
+            if (failed->second.waiters == 0) {
+                shard.map.erase(failed);
+            } else {
+                failed->second.building = false;
+                shard.built.notify_all();
+            }
+            throw;
+        }
+        guard.lock();
+        Entry& entry = shard.map.find(key)->second;
+        entry.value = value;
+        entry.building = false;
+        if (entry.waiters != 0) {
+            entry.handoff = value;
+            shard.built.notify_all();
+        }
+        return value;
+    }
+
+    Hash hash_;
+    Shard shards_[kShards];
+};
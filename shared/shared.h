@@ -2,12 +2,28 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <atomic>
 #include <cstddef>  // std::nullptr_t
 #include <iostream>
 
 struct BlockBase {
-    size_t cnt{1};
+    // Increments are relaxed: a new reference can only be made from an existing one.
+    // Decrements release, and the one that hits zero acquires before destroying.
+    std::atomic<size_t> cnt{1};
     virtual ~BlockBase() = default;
+
+    void IncRef() {
+        cnt.fetch_add(1, std::memory_order_relaxed);
+    }
+    void DecRef() {
+        if (cnt.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            delete this;
+        }
+    }
+    size_t UseCount() const {
+        return cnt.load(std::memory_order_relaxed);
+    }
 };
 
 template <typename T>
@@ -82,7 +98,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
     }
 
@@ -92,7 +108,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
     }
 
@@ -118,7 +134,7 @@ public:
         ptr_ = ptr;
         block_ = other.block_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
     }
 
@@ -134,7 +150,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
         return *this;
     }
@@ -145,7 +161,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
         return *this;
     }
@@ -173,12 +189,7 @@ public:
     // Destructor
 
     ~SharedPtr() {
-        if (block_) {
-            --block_->cnt;
-            if (block_->cnt == 0) {
-                delete block_;
-            }
-        }
+        Reset();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -187,22 +198,17 @@ public:
     void Reset() {
         auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
         if (prev) {
-            --prev->cnt;
-            if (prev->cnt == 0) {
-                delete prev;
-            }
+            prev->DecRef();
         }
-        ptr_ = nullptr;
     }
     void Reset(T* ptr) {
         auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
         if (prev) {
-            --prev->cnt;
-            if (prev->cnt == 0) {
-                delete prev;
-            }
+            prev->DecRef();
         }
         block_ = new Block(ptr);
         ptr_ = ptr;
@@ -211,11 +217,9 @@ public:
     void Reset(Y* ptr) {
         auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
         if (prev) {
-            --prev->cnt;
-            if (prev->cnt == 0) {
-                delete prev;
-            }
+            prev->DecRef();
         }
         block_ = new Block<Y>(ptr);
         ptr_ = ptr;
@@ -241,7 +245,7 @@ public:
         if (!block_) {
             return 0;
         }
-        return block_->cnt;
+        return block_->UseCount();
     }
     explicit operator bool() const {
         return block_;
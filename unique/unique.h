@@ -3,6 +3,8 @@
 
 #include "compressed_pair.h"
 
+#include <common/ptr_stats.h>
+
 #include <cstddef>  // std::nullptr_t
 
 template <typename T>
@@ -28,22 +30,32 @@ public:
 
     explicit UniquePtr(T* ptr = nullptr) {
         ptr_.GetFirst() = ptr;
+        PTR_STATS_IF(ptr, UniquePtr, T, Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T, Allocate);
     }
 
     UniquePtr(T* ptr, Deleter&& deleter) : ptr_(ptr, std::move(deleter)) {
+        PTR_STATS_IF(ptr, UniquePtr, T, Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T, Allocate);
     }
     UniquePtr(T* ptr, const Deleter& deleter) : ptr_(ptr, deleter) {
+        PTR_STATS_IF(ptr, UniquePtr, T, Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T, Allocate);
     }
 
     UniquePtr(UniquePtr&& other) noexcept {
         ptr_.GetFirst() = other.ptr_.GetFirst();
         ptr_.GetSecond() = std::move(other.ptr_.GetSecond());
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T, Move);
         other.ptr_.GetFirst() = nullptr;
     }
 
     template <typename Y, typename Ydeleter = MyDeleter<Y>>
     UniquePtr(UniquePtr<Y, Ydeleter>&& other) noexcept {
         ptr_.GetFirst() = static_cast<T*>(other.Release());
+        // `other` has counted the object as released
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T, Move);
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T, Allocate);
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,11 +68,14 @@ public:
         Reset();
         ptr_.GetFirst() = other.ptr_.GetFirst();
         ptr_.GetSecond() = std::move(other.ptr_.GetSecond());
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T, Move);
         other.ptr_.GetFirst() = nullptr;
         return *this;
     }
     UniquePtr& operator=(std::nullptr_t) {
         if (ptr_.GetFirst()) {
+            PTR_STATS(UniquePtr, T, Destroy);
+            PTR_STATS(UniquePtr, T, Release);
             ptr_.GetSecond()(ptr_.GetFirst());
             ptr_.GetFirst() = nullptr;
         }
@@ -72,6 +87,8 @@ public:
 
     ~UniquePtr() {
         if (ptr_.GetFirst()) {
+            PTR_STATS(UniquePtr, T, Destroy);
+            PTR_STATS(UniquePtr, T, Release);
             ptr_.GetSecond()(ptr_.GetFirst());
         }
     }
@@ -81,6 +98,8 @@ public:
 
     T* Release() {
         auto ptr = ptr_.GetFirst();
+        PTR_STATS_IF(ptr, UniquePtr, T, Destroy);
+        PTR_STATS_IF(ptr, UniquePtr, T, Release);
         ptr_.GetFirst() = nullptr;
         return ptr;
     }
@@ -88,8 +107,12 @@ public:
         auto ptr2 = ptr_.GetFirst();
         ptr_.GetFirst() = ptr;
         if (ptr2) {
+            PTR_STATS(UniquePtr, T, Destroy);
+            PTR_STATS(UniquePtr, T, Release);
             ptr_.GetSecond()(ptr2);
         }
+        PTR_STATS_IF(ptr, UniquePtr, T, Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T, Allocate);
     }
 
     void Swap(UniquePtr& other) {
@@ -135,22 +158,32 @@ public:
 
     explicit UniquePtr(T* ptr = nullptr) {
         ptr_.GetFirst() = ptr;
+        PTR_STATS_IF(ptr, UniquePtr, T[], Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T[], Allocate);
     }
 
     UniquePtr(T* ptr, Deleter&& deleter) : ptr_(ptr, std::move(deleter)) {
+        PTR_STATS_IF(ptr, UniquePtr, T[], Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T[], Allocate);
     }
     UniquePtr(T* ptr, const Deleter& deleter) : ptr_(ptr, deleter) {
+        PTR_STATS_IF(ptr, UniquePtr, T[], Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T[], Allocate);
     }
 
     UniquePtr(UniquePtr&& other) noexcept {
         ptr_.GetFirst() = other.ptr_.GetFirst();
         ptr_.GetSecond() = std::move(other.ptr_.GetSecond());
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T[], Move);
         other.ptr_.GetFirst() = nullptr;
     }
 
     template <typename Y, typename Ydeleter = MyDeleter<Y>>
     UniquePtr(UniquePtr<Y, Ydeleter>&& other) noexcept {
         ptr_.GetFirst() = static_cast<T*>(other.Release());
+        // `other` has counted the object as released
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T[], Move);
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T[], Allocate);
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -163,11 +196,14 @@ public:
         Reset();
         ptr_.GetFirst() = other.ptr_.GetFirst();
         ptr_.GetSecond() = std::move(other.ptr_.GetSecond());
+        PTR_STATS_IF(ptr_.GetFirst(), UniquePtr, T[], Move);
         other.ptr_.GetFirst() = nullptr;
         return *this;
     }
     UniquePtr& operator=(std::nullptr_t) {
         if (ptr_.GetFirst()) {
+            PTR_STATS(UniquePtr, T[], Destroy);
+            PTR_STATS(UniquePtr, T[], Release);
             ptr_.GetSecond()(ptr_.GetFirst());
             ptr_.GetFirst() = nullptr;
         }
@@ -179,6 +215,8 @@ public:
 
     ~UniquePtr() {
         if (ptr_.GetFirst()) {
+            PTR_STATS(UniquePtr, T[], Destroy);
+            PTR_STATS(UniquePtr, T[], Release);
             ptr_.GetSecond()(ptr_.GetFirst());
         }
     }
@@ -188,6 +226,8 @@ public:
 
     T* Release() {
         auto ptr = ptr_.GetFirst();
+        PTR_STATS_IF(ptr, UniquePtr, T[], Destroy);
+        PTR_STATS_IF(ptr, UniquePtr, T[], Release);
         ptr_.GetFirst() = nullptr;
         return ptr;
     }
@@ -195,8 +235,12 @@ public:
         auto ptr2 = ptr_.GetFirst();
         ptr_.GetFirst() = ptr;
         if (ptr2) {
+            PTR_STATS(UniquePtr, T[], Destroy);
+            PTR_STATS(UniquePtr, T[], Release);
             ptr_.GetSecond()(ptr2);
         }
+        PTR_STATS_IF(ptr, UniquePtr, T[], Construct);
+        PTR_STATS_IF(ptr, UniquePtr, T[], Allocate);
     }
 
     void Swap(UniquePtr& other) {
@@ -2,15 +2,53 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <atomic>
 #include <cstddef>  // std::nullptr_t
 #include <iostream>
 
 struct BlockBase {
-    size_t cnt{1};
-    size_t cnt_weak{0};
-    bool deleted = false;
+    // Increments are relaxed: a new reference can only be made from an existing one.
+    // Decrements release, and the one that hits zero acquires before destroying.
+    std::atomic<size_t> cnt{1};
+    // Weak references plus one held by all the strong references together,
+    // so only one thread ever sees the block die.
+    std::atomic<size_t> cnt_weak{1};
     virtual ~BlockBase() = default;
     virtual void DeletePtr() = 0;
+
+    void IncRef() {
+        cnt.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Takes a strong reference unless the object has expired. A single compare-and-swap, so a
+    // concurrent last release cannot slip in between the check and the increment.
+    bool TryIncRef() {
+        size_t old = cnt.load(std::memory_order_relaxed);
+        do {
+            if (old == 0) {
+                return false;
+            }
+        } while (!cnt.compare_exchange_weak(old, old + 1, std::memory_order_relaxed));
+        return true;
+    }
+    void DecRef() {
+        if (cnt.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            DeletePtr();
+            DecWeakRef();
+        }
+    }
+    void IncWeakRef() {
+        cnt_weak.fetch_add(1, std::memory_order_relaxed);
+    }
+    void DecWeakRef() {
+        if (cnt_weak.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            delete this;
+        }
+    }
+    size_t UseCount() const {
+        return cnt.load(std::memory_order_relaxed);
+    }
 };
 
 template <typename T>
@@ -18,18 +56,9 @@ class Block : public BlockBase {
 public:
     explicit Block(T* ptr) : ptr(ptr) {
     }
-    ~Block() override {
-        if (!deleted) {
-            delete ptr;
-        }
-        deleted = true;
-    }
     void DeletePtr() override {
-        if (!deleted) {
-            delete ptr;
-            ptr = nullptr;
-        }
-        deleted = true;
+        delete ptr;
+        ptr = nullptr;
     }
     T* Get() {
         return ptr;
@@ -44,17 +73,8 @@ public:
     BlockEmplace(Args&&... args) {
         new (storage) T{std::forward<Args>(args)...};
     }
-    ~BlockEmplace() override {
-        if (!deleted) {
-            reinterpret_cast<T*>(&storage)->~T();
-        }
-        deleted = true;
-    }
     void DeletePtr() override {
-        if (!deleted) {
-            reinterpret_cast<T*>(&storage)->~T();
-        }
-        deleted = true;
+        reinterpret_cast<T*>(&storage)->~T();
     }
     T* Get() {
         return reinterpret_cast<T*>(&storage);
@@ -89,14 +109,9 @@ public:
     explicit SharedPtr(BlockBase* bb, T* ptr, bool new_one = false) {
         block_ = bb;
         ptr_ = ptr;
-        if (new_one) {
-            if (block_) {
-                if (block_->deleted) {
-                    ptr_ = nullptr;
-                }
-                block_->deleted = false;
-                ++block_->cnt;
-            }
+        if (new_one && block_ && !block_->TryIncRef()) {
+            block_ = nullptr;
+            ptr_ = nullptr;
         }
     }
 
@@ -104,7 +119,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
     }
 
@@ -113,7 +128,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
     }
 
@@ -139,7 +154,7 @@ public:
         ptr_ = ptr;
         block_ = other.block_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
     }
 
@@ -147,14 +162,11 @@ public:
     // #11 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
 
     explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.block_->deleted) {
+        if (!other.block_ || !other.block_->TryIncRef()) {
             throw BadWeakPtr();
         }
         block_ = other.block_;
         ptr_ = other.ptr_;
-        if (block_) {
-            ++block_->cnt;
-        }
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -165,7 +177,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
         return *this;
     }
@@ -176,7 +188,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt;
+            block_->IncRef();
         }
         return *this;
     }
@@ -204,16 +216,7 @@ public:
     // Destructor
 
     ~SharedPtr() {
-        if (block_) {
-            --block_->cnt;
-            if (block_->cnt == 0 && block_->cnt_weak == 0) {
-                delete block_;
-            } else {
-                if (block_->cnt == 0) {
-                    block_->DeletePtr();
-                }
-            }
-        }
+        Reset();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -222,30 +225,17 @@ public:
     void Reset() {
         auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
         if (prev) {
-            --prev->cnt;
-            if (prev->cnt == 0 && prev->cnt_weak == 0) {
-                delete prev;
-            } else {
-                if (prev->cnt == 0) {
-                    prev->DeletePtr();
-                }
-            }
+            prev->DecRef();
         }
-        ptr_ = nullptr;
     }
     void Reset(T* ptr) {
         auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
         if (prev) {
-            --prev->cnt;
-            if (prev->cnt == 0 && prev->cnt_weak == 0) {
-                delete prev;
-            } else {
-                if (prev->cnt == 0) {
-                    prev->DeletePtr();
-                }
-            }
+            prev->DecRef();
         }
         block_ = new Block(ptr);
         ptr_ = ptr;
@@ -254,15 +244,9 @@ public:
     void Reset(Y* ptr) {
         auto prev = block_;
         block_ = nullptr;
+        ptr_ = nullptr;
         if (prev) {
-            --prev->cnt;
-            if (prev->cnt == 0 && prev->cnt_weak == 0) {
-                delete prev;
-            } else {
-                if (prev->cnt == 0) {
-                    prev->DeletePtr();
-                }
-            }
+            prev->DecRef();
         }
         block_ = new Block<Y>(ptr);
         ptr_ = ptr;
@@ -276,25 +260,22 @@ public:
     // Observers
 
     T* Get() const {
-        if (block_ && block_->deleted) {
-            return nullptr;
-        }
         return ptr_;
     }
     T& operator*() const {
         return *ptr_;
     }
     T* operator->() const {
-        return Get();
+        return ptr_;
     }
     size_t UseCount() const {
         if (!block_) {
             return 0;
         }
-        return block_->cnt;
+        return block_->UseCount();
     }
     explicit operator bool() const {
-        return block_;
+        return ptr_ != nullptr;
     }
     BlockBase* block_ = nullptr;
 };
@@ -5,6 +5,9 @@
 
 #include <catch.hpp>
 
+#include <atomic>
+#include <thread>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TEST_CASE("Empty weak") {
@@ -162,4 +165,29 @@ TEST_CASE("Lifetimes") {
         }
         delete wp;
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Lock races the last release") {
+    for (int round = 0; round < 200; ++round) {
+        auto sp = MakeShared<MyInt>(round);
+        WeakPtr<MyInt> weak = sp;
+        std::atomic<bool> bad_value = false;
+        std::thread locker([weak, round, &bad_value] {
+            while (auto locked = weak.Lock()) {
+                if (!(*locked == round)) {
+                    bad_value = true;
+                }
+            }
+            try {
+                SharedPtr<MyInt> promoted(weak);
+                bad_value = true;
+            } catch (const BadWeakPtr&) {
+            }
+        });
+        sp.Reset();
+        locker.join();
+        REQUIRE(!bad_value);
+        REQUIRE(weak.Expired());
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
@@ -18,7 +18,7 @@ public:
             block_ = other.block_;
             ptr_ = other.ptr_;
             if (block_) {
-                ++block_->cnt_weak;
+                block_->IncWeakRef();
             }
         }
     }
@@ -37,7 +37,7 @@ public:
         block_ = other.block_;
         ptr_ = other.ptr_;
         if (block_) {
-            ++block_->cnt_weak;
+            block_->IncWeakRef();
         }
     }
 
@@ -50,7 +50,7 @@ public:
             block_ = other.block_;
             ptr_ = other.ptr_;
             if (block_) {
-                ++block_->cnt_weak;
+                block_->IncWeakRef();
             }
         }
         return *this;
@@ -77,14 +77,12 @@ public:
     // Modifiers
 
     void Reset() {
-        if (block_) {
-            --block_->cnt_weak;
-            if (block_->cnt_weak == 0 && block_->cnt == 0) {
-                delete block_;
-            }
-        }
+        auto prev = block_;
         block_ = nullptr;
         ptr_ = nullptr;
+        if (prev) {
+            prev->DecWeakRef();
+        }
     }
     void Swap(WeakPtr& other) {
         std::swap(block_, other.block_);
@@ -98,7 +96,7 @@ public:
         if (!block_) {
             return 0;
         }
-        return block_->cnt;
+        return block_->UseCount();
     }
     bool Expired() const {
         if (ptr_ == nullptr) {
@@ -107,7 +105,7 @@ public:
         if (block_ == nullptr) {
             return true;
         }
-        if (block_->cnt == 0) {
+        if (block_->UseCount() == 0) {
             return true;
         }
         return false;